@@ -0,0 +1,116 @@
+// MpmcQueue.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 有界无锁多生产者多消费者环形队列（Dmitry Vyukov 的算法）。
+// 每个槽位带一个序号：序号 == 位置 表示可写，== 位置 + 1 表示可读；
+// 生产者和消费者各自只 CAS 自己的游标，游标之间用整条缓存行隔开，避免伪共享。
+// 容量向上取整为 2 的幂。队列满/空时立即返回 false，不阻塞
+template<class T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity)
+        : mask_(round_up(capacity) - 1), cells_(mask_ + 1), enqueue_pos_(0), dequeue_pos_(0) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcQueue() {
+        T value;
+        while (try_pop(value)) {
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // 只有成功入队时才移走 value，失败时调用方仍持有它
+    bool try_push(T&& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 满
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (&cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        Cell* cell;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 空
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* value = reinterpret_cast<T*>(&cell->storage);
+        out = std::move(*value);
+        value->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 近似长度：并发修改时只作参考
+    size_t size_approx() const {
+        size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty_approx() const { return size_approx() == 0; }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static size_t round_up(size_t n) {
+        size_t result = 2;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t mask_;
+    std::vector<Cell> cells_;
+    char pad0_[kCacheLine];
+    std::atomic<size_t> enqueue_pos_;   // 生产者游标
+    char pad1_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_;   // 消费者游标
+    char pad2_[kCacheLine - sizeof(std::atomic<size_t>)];
+};
@@ -0,0 +1,240 @@
+// TaskGraph.hpp
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// 有向无环任务图：先 emplace 节点、用 precede/succeed 声明依赖，再交给线程池执行。
+// 每个节点带一个原子入度计数，前驱完成时递减，降到 0 的后继由完成最后一个前驱的工作线程接手：
+// 第一个就绪后继直接在当前线程继续执行，其余压入该线程的本地队列。任何任务都不会阻塞等待其他任务。
+// 图可反复 run：节点与边只在结构变化后的第一次 run 时校验一次，之后每次运行只重置计数，不再分配内存
+class TaskGraph {
+    struct Node;
+
+public:
+    // 节点句柄，只在所属 TaskGraph 存活期间有效
+    class TaskNode {
+    public:
+        TaskNode() : graph_(nullptr), node_(nullptr) {}
+
+        // 声明 this 必须在 other 之前完成
+        TaskNode& precede(TaskNode other) {
+            graph_->add_edge(node_, other.node_);
+            return *this;
+        }
+
+        // 声明 other 必须在 this 之前完成
+        TaskNode& succeed(TaskNode other) {
+            graph_->add_edge(other.node_, node_);
+            return *this;
+        }
+
+        bool valid() const { return node_ != nullptr; }
+
+    private:
+        friend class TaskGraph;
+        TaskNode(TaskGraph* graph, Node* node) : graph_(graph), node_(node) {}
+
+        TaskGraph* graph_;
+        Node* node_;
+    };
+
+    TaskGraph() : validated_(true), pool_(nullptr), remaining_(0), failed_(false), running_(false) {}
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // 析构前必须等待 run 返回的 Future
+    ~TaskGraph() = default;
+
+    template<class F>
+    TaskNode emplace(F&& work) {
+        check_idle();
+        nodes_.emplace_back(Task(std::forward<F>(work)));
+        validated_ = false;
+        return TaskNode(this, &nodes_.back());
+    }
+
+    size_t size() const { return nodes_.size(); }
+
+    // 在 pool 上执行整张图，所有节点完成后 Future 就绪；
+    // 某个节点抛出异常时，尚未开始的节点跳过执行，Future 携带第一个异常。
+    // 图中有环时抛出 std::invalid_argument；上一次运行尚未结束时抛出 std::logic_error
+    Future<void> run(ThreadPool& pool) {
+        check_idle();
+        if (!validated_) {
+            validate();
+        }
+        Promise<void> promise;
+        Future<void> result = promise.get_future();
+        if (nodes_.empty()) {
+            promise.set_value();
+            return result;
+        }
+
+        running_.store(true);
+        pool_ = &pool;
+        promise_ = std::move(promise);
+        error_ = nullptr;
+        failed_.store(false, std::memory_order_relaxed);
+        remaining_.store(nodes_.size(), std::memory_order_relaxed);
+        for (Node& node : nodes_) {
+            node.pending.store(node.in_degree, std::memory_order_relaxed);
+        }
+        // 逐个入队：最后一个源节点入队后整张图随时可能完成、兑现 Promise，调用方随即可以析构或重新运行图，
+        // 所以先把源节点取到局部变量，循环中不再读成员
+        size_t sources = sources_.size();
+        Node* const* first = sources_.data();
+        try {
+            enqueue(first[0]);
+        } catch (...) {
+            // 线程池已停止：还没有任何节点开始执行，恢复空闲状态后抛给调用方
+            promise_.set_exception(std::current_exception());
+            running_.store(false);
+            throw;
+        }
+        for (size_t i = 1; i < sources; ++i) {
+            schedule(first[i]);
+        }
+        return result;
+    }
+
+private:
+    struct Node {
+        Task work;   // 可以是只可移动的闭包；小闭包存放在内联缓冲区，添加节点不分配
+        std::vector<Node*> successors;
+        size_t in_degree;
+        std::atomic<size_t> pending;   // 本次运行中尚未完成的前驱数
+
+        explicit Node(Task&& w) : work(std::move(w)), in_degree(0), pending(0) {}
+    };
+
+    // 在工作线程上执行一个就绪节点，并沿着第一个就绪后继一直执行下去
+    struct Runner {
+        TaskGraph* graph;
+        Node* node;
+        void operator()() { graph->execute(node); }
+    };
+
+    void check_idle() const {
+        if (running_.load()) {
+            throw std::logic_error("TaskGraph modified or run while a previous run is in progress");
+        }
+    }
+
+    void add_edge(Node* from, Node* to) {
+        check_idle();
+        from->successors.push_back(to);
+        to->in_degree++;
+        validated_ = false;
+    }
+
+    // 重新收集源节点，并用 Kahn 算法确认无环
+    void validate() {
+        sources_.clear();
+        std::vector<size_t> degree;
+        std::vector<Node*> ready;
+        degree.reserve(nodes_.size());
+        for (Node& node : nodes_) {
+            node.pending.store(node.in_degree, std::memory_order_relaxed);
+            if (node.in_degree == 0) {
+                sources_.push_back(&node);
+                ready.push_back(&node);
+            }
+        }
+        size_t visited = 0;
+        while (!ready.empty()) {
+            Node* node = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (Node* next : node->successors) {
+                if (next->pending.fetch_sub(1, std::memory_order_relaxed) == 1) {
+                    ready.push_back(next);
+                }
+            }
+        }
+        if (visited != nodes_.size()) {
+            sources_.clear();
+            throw std::invalid_argument("TaskGraph contains a cycle");
+        }
+        validated_ = true;
+    }
+
+    // 就绪节点进入当前线程的本地队列（从外部线程调用时进入全局队列），不受有界队列容量限制
+    void enqueue(Node* node) {
+        pool_->enqueue(Task(Runner{this, node}), TaskPriority::normal, ThreadPool::AdmitMode::force);
+    }
+
+    // 运行途中线程池已停止、入队失败时，记下异常并在当前线程上以跳过方式走完该节点：
+    // 不执行工作，只递减后继的计数并逐个 finish_one，remaining_ 照常归零，Future 带着异常就绪
+    void schedule(Node* node) {
+        try {
+            enqueue(node);
+        } catch (...) {
+            if (!failed_.exchange(true)) {
+                error_ = std::current_exception();
+            }
+            execute(node);
+        }
+    }
+
+    void execute(Node* node) {
+        while (node) {
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    node->work();
+                } catch (...) {
+                    if (!failed_.exchange(true)) {
+                        error_ = std::current_exception();
+                    }
+                }
+            }
+            Node* next = nullptr;
+            for (Node* successor : node->successors) {
+                if (successor->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next) {
+                        schedule(successor);
+                    } else {
+                        next = successor;
+                    }
+                }
+            }
+            finish_one();
+            node = next;
+        }
+    }
+
+    // 最后一个节点完成时兑现 Promise；兑现之后图可能已被析构或重新运行，不再访问成员
+    void finish_one() {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        Promise<void> promise = std::move(promise_);
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        running_.store(false);
+        if (error) {
+            promise.set_exception(error);
+        } else {
+            promise.set_value();
+        }
+    }
+
+    std::deque<Node> nodes_;            // deque 保证节点地址稳定
+    std::vector<Node*> sources_;        // 入度为 0 的节点，validate 时重建
+    bool validated_;
+
+    ThreadPool* pool_;
+    Promise<void> promise_;
+    std::exception_ptr error_;
+    std::atomic<size_t> remaining_;
+    std::atomic<bool> failed_;
+    std::atomic<bool> running_;
+};
@@ -0,0 +1,132 @@
+// TaskGroup.hpp
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// 任务组：run(f) 把任务投递到线程池，wait() 等到已投递的任务全部结束。
+// 计数只用一个原子变量（最低位标记有人挂起等待）。工作线程里调用 wait() 时不会挂起，
+// 而是继续从线程池取任务执行直到本组完成，所以任务内部嵌套 fork-join 不会占住线程，满员的线程池也不会死锁。
+// 代为执行的可能是任意任务：调用 wait() 时不要持有那些任务也会获取的锁
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(&pool), state_(0), failed_(false) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // 任务引用着本对象，析构前必须等它们结束；此时的异常被丢弃
+    ~TaskGroup() {
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    // 入队不受有界队列容量限制：工作线程内提交时被拒绝或阻塞都会破坏 fork-join
+    template<class F>
+    void run(F&& f) {
+        state_.fetch_add(kOne, std::memory_order_relaxed);
+        try {
+            pool_->enqueue(Task(Runner<typename std::decay<F>::type>{this, std::forward<F>(f)}),
+                           TaskPriority::normal, ThreadPool::AdmitMode::force);
+        } catch (...) {
+            finish();
+            throw;
+        }
+    }
+
+    // 等待已投递的任务全部结束；有任务抛出异常时重新抛出第一个，之后本组可以继续使用。
+    // 一旦有任务失败，尚未开始的任务被跳过
+    void wait() {
+        // 工作线程挂起后隔这么久醒来，看看有没有新任务可以代为执行
+        const std::chrono::microseconds help_interval(200);
+        bool worker = pool_->local_slot() != nullptr;
+        int idle_rounds = 0;
+        while (pending() != 0) {
+            if (worker && pool_->help_one()) {
+                idle_rounds = 0;
+                continue;
+            }
+            if (idle_rounds < kSpinLimit) {
+                ++idle_rounds;
+                if (idle_rounds < kSpinLimit - kYieldLimit && threadpool_detail::cpu_count() > 1) {
+                    threadpool_detail::cpu_relax();
+                } else {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            // 剩下的任务都在别的线程上运行：挂起。工作线程定期醒来看看有没有新任务可以代为执行
+            threadpool_detail::ParkingBucket& bucket = threadpool_detail::parking_bucket(this);
+            std::unique_lock<std::mutex> lock(bucket.mutex);
+            state_.fetch_or(kWaiting, std::memory_order_acq_rel);
+            if (worker) {
+                bucket.cv.wait_for(lock, help_interval, [this]() { return pending() == 0; });
+            } else {
+                bucket.cv.wait(lock, [this]() { return pending() == 0; });
+            }
+        }
+        if (failed_.load(std::memory_order_acquire)) {
+            std::exception_ptr error = std::move(error_);
+            error_ = nullptr;
+            failed_.store(false, std::memory_order_release);
+            std::rethrow_exception(error);
+        }
+    }
+
+    // 已投递但尚未结束的任务数
+    size_t pending() const { return state_.load(std::memory_order_acquire) / kOne; }
+
+private:
+    static const size_t kWaiting = 1;
+    static const size_t kOne = 2;
+    static const int kSpinLimit = 256;
+    static const int kYieldLimit = 16;
+
+    template<class Fn>
+    struct Runner {
+        TaskGroup* group;
+        Fn fn;
+
+        void operator()() {
+            if (!group->failed_.load(std::memory_order_acquire)) {
+                try {
+                    fn();
+                } catch (...) {
+                    group->fail(std::current_exception());
+                }
+            }
+            group->finish();
+        }
+    };
+
+    void fail(std::exception_ptr error) {
+        if (!failed_.exchange(true, std::memory_order_acq_rel)) {
+            error_ = std::move(error);
+        }
+    }
+
+    // 计数归零后等待方可能立刻销毁本对象：之后只访问静态的停车桶，不再访问成员
+    void finish() {
+        size_t prev = state_.fetch_sub(kOne, std::memory_order_acq_rel);
+        if (prev / kOne == 1 && (prev & kWaiting)) {
+            threadpool_detail::ParkingBucket& bucket = threadpool_detail::parking_bucket(this);
+            { std::lock_guard<std::mutex> lock(bucket.mutex); }
+            bucket.cv.notify_all();
+        }
+    }
+
+    ThreadPool* pool_;
+    std::atomic<size_t> state_;
+    std::atomic<bool> failed_;
+    std::exception_ptr error_;
+};
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -13,192 +14,4317 @@
 #include <iostream>
 #include <chrono>
 #include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <iterator>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
 
-class ThreadPool {
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define THREADPOOL_HAS_PMR 1
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define THREADPOOL_NOINLINE __attribute__((noinline))
+#else
+#define THREADPOOL_NOINLINE
+#endif
+
+#include "MpmcQueue.hpp"
+
+// 轻量自旋锁：只用于保护临界区极短的每线程任务队列
+class SpinLock {
 public:
-    explicit ThreadPool(size_t min_threads = std::thread::hardware_concurrency(),
-                       size_t max_threads = std::thread::hardware_concurrency() * 2,
-                       std::chrono::milliseconds min_stable_time = std::chrono::seconds(5)) // 默认冷却期5秒
-        : shutdown_(false), min_threads_(min_threads), max_threads_(max_threads), 
-          min_stable_time_(min_stable_time) // 初始化最短稳定时间
-    {
-        last_scale_time_ = std::chrono::steady_clock::now() - min_stable_time_; // 初始化时设置为"允许操作"
-        // 先创建所有线程，但不立即启动工作循环
-        for (size_t i = 0; i < min_threads_; ++i) {
-            workers_.emplace_back([this]() { 
-                // 短暂的延迟，确保主线程完成初始化
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                worker_loop(); 
-            });
+    void lock() {
+        int spins = 0;
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            if (++spins > 64) {
+                std::this_thread::yield(); // 持锁线程可能被调度走了，让出CPU
+                spins = 0;
+            }
+        }
+    }
+
+    bool try_lock() {
+        return !flag_.test_and_set(std::memory_order_acquire);
+    }
+
+    void unlock() {
+        flag_.clear(std::memory_order_release);
+    }
+
+private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+namespace threadpool_detail {
+
+// C++11 没有 std::index_sequence，自己实现一个用于展开参数元组
+template<size_t... I> struct IndexSeq {};
+template<size_t N, size_t... I> struct MakeIndexSeq : MakeIndexSeq<N - 1, N - 1, I...> {};
+template<size_t... I> struct MakeIndexSeq<0, I...> { typedef IndexSeq<I...> type; };
+
+// 替代 std::bind：按值保存可调用对象和参数，调用时展开
+template<class F, class... Args>
+struct BoundCall {
+    typedef typename std::result_of<F&(Args&...)>::type result_type;
+
+    F f;
+    std::tuple<Args...> args;
+
+    template<class FF, class... AA>
+    explicit BoundCall(FF&& ff, AA&&... aa)
+        : f(std::forward<FF>(ff)), args(std::forward<AA>(aa)...) {}
+
+    result_type operator()() {
+        return call(typename MakeIndexSeq<sizeof...(Args)>::type());
+    }
+
+    template<size_t... I>
+    result_type call(IndexSeq<I...>) {
+        return f(std::get<I>(args)...);
+    }
+};
+
+// 无参数时直接保存可调用对象，不引入 tuple
+template<class F>
+struct BoundCall<F> {
+    typedef typename std::result_of<F&()>::type result_type;
+
+    F f;
+
+    template<class FF>
+    explicit BoundCall(FF&& ff) : f(std::forward<FF>(ff)) {}
+
+    result_type operator()() {
+        return f();
+    }
+};
+
+template<class F, class... Args>
+BoundCall<typename std::decay<F>::type, typename std::decay<Args>::type...>
+bind_call(F&& f, Args&&... args) {
+    return BoundCall<typename std::decay<F>::type, typename std::decay<Args>::type...>(
+        std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+// 线程池自身的小块内存：放不进 Task 内联缓冲区的闭包、每线程队列（deque）的节点。
+// 按 64 字节分级分配，释放时回收到当前线程的空闲链表。工作线程执行完任务后块留在本线程，
+// 它再提交子任务（fork-join、任务图、延续）时直接复用，不进入全局 malloc
+class TaskBlockCache {
+public:
+    static const size_t kGranule = 64;
+    static const size_t kClasses = 8;      // 最大 512 字节（正好容纳 libstdc++ 的 deque 节点），更大的直接走 operator new
+    static const size_t kLimit = 1024;     // 每个线程每级最多缓存的块数
+
+    static void* allocate(size_t size) {
+        size_t c = class_of(size);
+        if (c >= kClasses) {
+            return ::operator new(size);
+        }
+        Lists& lists = local();
+        if (Block* block = lists.head[c]) {
+            lists.head[c] = block->next;
+            --lists.count[c];
+            return block;
+        }
+        return ::operator new((c + 1) * kGranule);
+    }
+
+    static void deallocate(void* p, size_t size) {
+        size_t c = class_of(size);
+        Lists& lists = local();
+        if (c >= kClasses || lists.closed || lists.count[c] >= kLimit) {
+            ::operator delete(p);
+            return;
+        }
+        Block* block = static_cast<Block*>(p);
+        block->next = lists.head[c];
+        lists.head[c] = block;
+        ++lists.count[c];
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    struct Lists {
+        Block* head[kClasses];
+        size_t count[kClasses];
+        bool closed;   // 线程退出时已释放；之后（其他 thread_local 析构中）归还的块直接释放
+
+        Lists() : closed(false) {
+            for (size_t c = 0; c < kClasses; ++c) {
+                head[c] = nullptr;
+                count[c] = 0;
+            }
+        }
+
+        ~Lists() {
+            for (size_t c = 0; c < kClasses; ++c) {
+                while (Block* block = head[c]) {
+                    head[c] = block->next;
+                    ::operator delete(block);
+                }
+                count[c] = 0;
+            }
+            closed = true;
+        }
+    };
+
+    static size_t class_of(size_t size) { return size == 0 ? 0 : (size - 1) / kGranule; }
+
+    static Lists& local() {
+        static thread_local Lists lists;
+        return lists;
+    }
+};
+
+// 经 TaskBlockCache 分配的 STL 分配器，用于任务队列
+template<class T>
+struct BlockAllocator {
+    typedef T value_type;
+
+    BlockAllocator() noexcept {}
+    template<class U>
+    BlockAllocator(const BlockAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(TaskBlockCache::allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) noexcept { TaskBlockCache::deallocate(p, n * sizeof(T)); }
+};
+
+template<class T, class U>
+bool operator==(const BlockAllocator<T>&, const BlockAllocator<U>&) noexcept { return true; }
+
+template<class T, class U>
+bool operator!=(const BlockAllocator<T>&, const BlockAllocator<U>&) noexcept { return false; }
+
+} // namespace threadpool_detail
+
+// 只可移动的任务包装，取代 std::function<void()>：
+// 不超过 kInlineSize 的闭包直接存放在内部缓冲区，只有大闭包才会堆分配（经 TaskBlockCache 按线程回收）。
+// 另带一个入队时间戳，只在开启延迟直方图时填写
+class Task {
+public:
+    static const size_t kInlineSize = 56;
+
+    Task() noexcept : ops_(nullptr), enqueued_ns_(0) {}
+
+    template<class F, class = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) : ops_(nullptr), enqueued_ns_(0) {
+        typedef typename std::decay<F>::type Fn;
+        construct<Fn>(std::forward<F>(f), std::integral_constant<bool, fits_inline<Fn>()>());
+    }
+
+    Task(Task&& other) noexcept : ops_(other.ops_), enqueued_ns_(other.enqueued_ns_) {
+        if (ops_) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_) {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+            enqueued_ns_ = other.enqueued_ns_;
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(&storage_); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    int64_t enqueued_ns() const noexcept { return enqueued_ns_; }
+    void set_enqueued_ns(int64_t ns) noexcept { enqueued_ns_ = ns; }
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    typedef typename std::aligned_storage<kInlineSize, alignof(void*)>::type Storage;
+
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);   // 移动到 dst 并析构 src
+        void (*destroy)(void*);
+    };
+
+    template<class Fn>
+    static constexpr bool fits_inline() {
+        return sizeof(Fn) <= kInlineSize &&
+               alignof(Fn) <= alignof(Storage) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template<class Fn>
+    struct InlineOps {
+        static void invoke(void* p) { (*static_cast<Fn*>(p))(); }
+        static void move(void* dst, void* src) {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void destroy(void* p) { static_cast<Fn*>(p)->~Fn(); }
+        static const Ops* ops() {
+            static const Ops table = { &invoke, &move, &destroy };
+            return &table;
+        }
+    };
+
+    template<class Fn>
+    struct HeapOps {
+        static Fn*& ptr(void* p) { return *static_cast<Fn**>(p); }
+        static void invoke(void* p) { (*ptr(p))(); }
+        static void move(void* dst, void* src) { ::new (dst) Fn*(ptr(src)); }
+        static void destroy(void* p) {
+            Fn* fn = ptr(p);
+            fn->~Fn();
+            threadpool_detail::TaskBlockCache::deallocate(fn, sizeof(Fn));
+        }
+        static const Ops* ops() {
+            static const Ops table = { &invoke, &move, &destroy };
+            return &table;
+        }
+    };
+
+    template<class Fn, class F>
+    void construct(F&& f, std::true_type) {
+        ::new (&storage_) Fn(std::forward<F>(f));
+        ops_ = InlineOps<Fn>::ops();
+    }
+
+    template<class Fn, class F>
+    void construct(F&& f, std::false_type) {
+        void* block = threadpool_detail::TaskBlockCache::allocate(sizeof(Fn));
+        try {
+            ::new (block) Fn(std::forward<F>(f));
+        } catch (...) {
+            threadpool_detail::TaskBlockCache::deallocate(block, sizeof(Fn));
+            throw;
+        }
+        ::new (&storage_) Fn*(static_cast<Fn*>(block));
+        ops_ = HeapOps<Fn>::ops();
+    }
+
+    const Ops* ops_;
+    int64_t enqueued_ns_;
+    Storage storage_;
+};
+
+// 工作线程私有的任务内存池：从大块里顺序切分（单调分配），只有拥有者线程访问，不加锁。
+// 线程池在每个任务结束后把它回退到任务开始时的位置，块留给下一个任务复用，
+// 所以任务里的短命分配（临时缓冲、容器）既不争用全局 malloc，也不需要逐个释放。
+// 分配的内存只在当前任务内有效，不能交给其他任务或作为结果返回。
+// C++17 下它同时是 std::pmr::memory_resource，可直接交给 std::pmr 容器
+class WorkerArena
+#if defined(THREADPOOL_HAS_PMR)
+    : public std::pmr::memory_resource
+#endif
+{
+public:
+    // 回退点：mark() 记录当前位置，rewind() 释放其后的全部分配
+    struct Marker {
+        void* chunk;
+        char* ptr;
+    };
+
+    explicit WorkerArena(size_t chunk_bytes = 64 * 1024)
+        : chunk_bytes_(std::max<size_t>(chunk_bytes, 1024)), current_(nullptr), spare_(nullptr),
+          spare_count_(0), ptr_(nullptr), end_(nullptr) {}
+
+    WorkerArena(const WorkerArena&) = delete;
+    WorkerArena& operator=(const WorkerArena&) = delete;
+
+    ~WorkerArena() {
+        reset();
+        while (spare_) {
+            Chunk* next = spare_->prev;
+            ::operator delete(spare_);
+            spare_ = next;
+        }
+    }
+
+    // align 必须是 2 的幂。不内联：返回的指针对调用方不透明（与 malloc 相同），
+    // 否则 GCC 会把调用方对这块内存的循环与内存池自身的指针一起分析而放弃向量化
+    THREADPOOL_NOINLINE void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (current_) {
+            char* p = align_up(ptr_, align);
+            if (bytes <= static_cast<size_t>(end_ - p)) {
+                ptr_ = p + bytes;
+                return p;
+            }
+        }
+        return allocate_slow(bytes, align);
+    }
+
+    // 只有最近一次分配能真正收回，其余等回退时统一释放
+    void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) noexcept {
+        (void)align;
+        if (static_cast<char*>(p) + bytes == ptr_) {
+            ptr_ = static_cast<char*>(p);
+        }
+    }
+
+    Marker mark() const noexcept {
+        Marker m = { current_, ptr_ };
+        return m;
+    }
+
+    void rewind(const Marker& m) noexcept {
+        while (current_ != m.chunk) {
+            Chunk* chunk = current_;
+            current_ = chunk->prev;
+            recycle(chunk);
+        }
+        if (current_) {
+            ptr_ = m.ptr;
+            end_ = data(current_) + current_->size;
+        } else {
+            ptr_ = end_ = nullptr;
+        }
+    }
+
+    void reset() noexcept {
+        Marker empty = { nullptr, nullptr };
+        rewind(empty);
+    }
+
+    // 当前持有的块总字节数（使用中 + 备用）
+    size_t capacity() const noexcept {
+        size_t total = 0;
+        for (Chunk* c = current_; c; c = c->prev) {
+            total += c->size;
+        }
+        for (Chunk* c = spare_; c; c = c->prev) {
+            total += c->size;
+        }
+        return total;
+    }
+
+private:
+    // 回退后最多保留的备用块数，多出的归还给系统
+    static const size_t kSpareChunks = 4;
+
+    struct alignas(std::max_align_t) Chunk {
+        Chunk* prev;
+        size_t size;   // 数据区字节数
+    };
+
+    static char* data(Chunk* chunk) { return reinterpret_cast<char*>(chunk + 1); }
+
+    static char* align_up(char* p, size_t align) {
+        uintptr_t v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((v + align - 1) & ~(static_cast<uintptr_t>(align) - 1));
+    }
+
+    void* allocate_slow(size_t bytes, size_t align) {
+        size_t need = bytes + align;
+        Chunk* chunk;
+        if (need <= chunk_bytes_ && spare_) {
+            chunk = spare_;
+            spare_ = chunk->prev;
+            --spare_count_;
+        } else {
+            size_t size = std::max(need, chunk_bytes_);
+            chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+            chunk->size = size;
+        }
+        chunk->prev = current_;
+        current_ = chunk;
+        char* p = align_up(data(chunk), align);
+        ptr_ = p + bytes;
+        end_ = data(chunk) + chunk->size;
+        return p;
+    }
+
+    void recycle(Chunk* chunk) noexcept {
+        if (chunk->size == chunk_bytes_ && spare_count_ < kSpareChunks) {
+            chunk->prev = spare_;
+            spare_ = chunk;
+            ++spare_count_;
+        } else {
+            ::operator delete(chunk);
+        }
+    }
+
+#if defined(THREADPOOL_HAS_PMR)
+    void* do_allocate(size_t bytes, size_t align) override { return allocate(bytes, align); }
+    void do_deallocate(void* p, size_t bytes, size_t align) override { deallocate(p, bytes, align); }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+#endif
+
+    size_t chunk_bytes_;
+    Chunk* current_;
+    Chunk* spare_;
+    size_t spare_count_;
+    char* ptr_;
+    char* end_;
+};
+
+// 从 WorkerArena 分配的 STL 分配器（C++11 下代替 std::pmr::polymorphic_allocator）；
+// arena 为空（不在工作线程上）时退回全局 operator new
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(WorkerArena* arena) noexcept : arena_(arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        if (!arena_) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (!arena_) {
+            ::operator delete(p);
+            return;
+        }
+        arena_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    WorkerArena* arena() const noexcept { return arena_; }
+
+private:
+    WorkerArena* arena_;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return !(a == b);
+}
+
+namespace threadpool_detail {
+
+// 自旋等待时的 CPU 提示，降低功耗并让出超线程的执行资源
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+inline unsigned cpu_count() {
+    static const unsigned n = std::max(1u, std::thread::hardware_concurrency());
+    return n;
+}
+
+// 等待者按共享状态地址散列到一组 mutex/condvar 上，共享状态本身不携带锁
+struct ParkingBucket {
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+inline ParkingBucket& parking_bucket(const void* addr) {
+    static const size_t kBuckets = 64;
+    static ParkingBucket buckets[kBuckets];
+    return buckets[(reinterpret_cast<uintptr_t>(addr) >> 6) % kBuckets];
+}
+
+// 每个工作线程独占的停车位，unpark 先于 park 时许可被保留（最多一个）。
+// Linux 上直接用 futex（空闲时不占内核对象），其他平台退化为 mutex + condvar 实现的二值信号量
+class Parker {
+public:
+#if defined(__linux__)
+    Parker() : state_(kEmpty) {}
+
+    void park() {
+        // EMPTY -> PARKED，或消费已有的许可 NOTIFIED -> EMPTY
+        if (state_.fetch_sub(1, std::memory_order_acquire) == kNotified) {
+            return;
+        }
+        while (true) {
+            syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAIT_PRIVATE, kParked, nullptr, nullptr, 0);
+            int expected = kNotified;
+            if (state_.compare_exchange_strong(expected, kEmpty, std::memory_order_acquire)) {
+                return;
+            }
+            // 虚假唤醒，继续等待
+        }
+    }
+
+    void unpark() {
+        if (state_.exchange(kNotified, std::memory_order_release) == kParked) {
+            syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+private:
+    static const int kParked = -1;
+    static const int kEmpty = 0;
+    static const int kNotified = 1;
+    std::atomic<int> state_;
+#else
+    Parker() : notified_(false) {}
+
+    void park() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return notified_; });
+        notified_ = false;
+    }
+
+    void unpark() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            notified_ = true;
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool notified_;
+#endif
+};
+
+// 一次性倒计时门闩（C++20 std::latch 的最小替代），用于等待工作线程就绪
+class Latch {
+public:
+    explicit Latch(size_t count) : count_(count) {}
+
+    void count_down() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ > 0 && --count_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return count_ == 0; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t count_;
+};
+
+struct Unit {};
+
+// 共享状态中实际保存的类型：引用存为指针，void 存为空结构
+template<class T>
+struct StoredType {
+    typedef T type;
+    template<class... A>
+    static void construct(void* p, A&&... a) { ::new (p) T(std::forward<A>(a)...); }
+    static T take(T& v) { return std::move(v); }
+};
+
+template<class T>
+struct StoredType<T&> {
+    typedef T* type;
+    static void construct(void* p, T& r) { ::new (p) T*(&r); }
+    static T& take(T* v) { return *v; }
+};
+
+template<>
+struct StoredType<void> {
+    typedef Unit type;
+    static void construct(void* p) { ::new (p) Unit(); }
+    static void take(Unit&) {}
+};
+
+// Future/Promise 的共享状态：无锁的就绪标志 + 单个完成回调槽，
+// 释放后回收到当前线程的空闲链表，稳定状态下不再触发堆分配
+template<class T>
+class SharedState {
+public:
+    typedef typename StoredType<T>::type Stored;
+
+    // 每个线程每种结果类型最多缓存的空闲状态数
+    static const size_t kFreeListLimit = 1 << 16;
+    static const int kSpinLimit = 256;
+    static const int kYieldLimit = 16;
+    static const int kSpinCheck = 16;
+
+    // 新状态的引用计数为2：一个属于 Promise，一个属于 Future
+    static SharedState* create() {
+        FreeList& list = free_list();
+        SharedState* s = list.head;
+        if (s) {
+            list.head = s->next_free_;
+            --list.size;
+        } else {
+            s = new SharedState();
+        }
+        s->flags_.store(0, std::memory_order_relaxed);
+        s->refs_.store(2, std::memory_order_relaxed);
+        return s;
+    }
+
+    void add_ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            recycle();
+        }
+    }
+
+    template<class... A>
+    void set_value(A&&... a) {
+        StoredType<T>::construct(&storage_, std::forward<A>(a)...);
+        has_value_ = true;
+        mark_ready();
+    }
+
+    void set_exception(std::exception_ptr e) {
+        error_ = std::move(e);
+        mark_ready();
+    }
+
+    bool is_ready() const {
+        return (flags_.load(std::memory_order_acquire) & kReady) != 0;
+    }
+
+    // 先短暂自旋（多数任务在微秒级完成），再让出几次CPU，最后才挂起
+    void wait() {
+        if (spin_until_ready()) {
+            return;
+        }
+        ParkingBucket& bucket = parking_bucket(this);
+        std::unique_lock<std::mutex> lock(bucket.mutex);
+        flags_.fetch_or(kWaiting, std::memory_order_acq_rel);
+        while (!is_ready()) {
+            bucket.cv.wait(lock);
+        }
+    }
+
+    // 自旋与让出阶段同样受 deadline 约束；deadline 已过时只查看一次状态（wait_for(0) 即轮询）
+    bool wait_until(std::chrono::steady_clock::time_point deadline) {
+        if (spin_until_ready(&deadline)) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return is_ready();
+        }
+        ParkingBucket& bucket = parking_bucket(this);
+        std::unique_lock<std::mutex> lock(bucket.mutex);
+        flags_.fetch_or(kWaiting, std::memory_order_acq_rel);
+        while (!is_ready()) {
+            if (bucket.cv.wait_until(lock, deadline) == std::cv_status::timeout) {
+                return is_ready();
+            }
+        }
+        return true;
+    }
+
+    // 注册完成回调：已就绪则在当前线程立即执行，否则由完成方执行，二者只会发生一次
+    void on_ready(Task&& callback) {
+        callback_ = std::move(callback);
+        unsigned prev = flags_.fetch_or(kHasCallback, std::memory_order_acq_rel);
+        if (prev & kReady) {
+            run_callback();
+        }
+    }
+
+    Stored& value() { return *reinterpret_cast<Stored*>(&storage_); }
+    const std::exception_ptr& error() const { return error_; }
+
+private:
+    enum : unsigned { kReady = 1, kHasCallback = 2, kWaiting = 4 };
+
+    struct FreeList {
+        SharedState* head = nullptr;
+        size_t size = 0;
+        ~FreeList() {
+            while (head) {
+                SharedState* next = head->next_free_;
+                delete head;
+                head = next;
+            }
+        }
+    };
+
+    static FreeList& free_list() {
+        static thread_local FreeList list;
+        return list;
+    }
+
+    SharedState() : flags_(0), refs_(0), has_value_(false), next_free_(nullptr) {}
+
+    // deadline 非空时，到期即停止自旋/让出（每 kSpinCheck 次自旋读一次时钟）
+    bool spin_until_ready(const std::chrono::steady_clock::time_point* deadline = nullptr) {
+        if (is_ready()) {
+            return true;
+        }
+        if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+            return false;
+        }
+        if (cpu_count() > 1) {
+            for (int i = 0; i < kSpinLimit; ++i) {
+                cpu_relax();
+                if (is_ready()) {
+                    return true;
+                }
+                if (deadline && i % kSpinCheck == kSpinCheck - 1 && std::chrono::steady_clock::now() >= *deadline) {
+                    return false;
+                }
+            }
+        }
+        for (int i = 0; i < kYieldLimit; ++i) {
+            std::this_thread::yield();
+            if (is_ready()) {
+                return true;
+            }
+            if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    void mark_ready() {
+        unsigned prev = flags_.fetch_or(kReady, std::memory_order_acq_rel);
+        if (prev & kWaiting) {
+            ParkingBucket& bucket = parking_bucket(this);
+            { std::lock_guard<std::mutex> lock(bucket.mutex); }
+            bucket.cv.notify_all();
+        }
+        if (prev & kHasCallback) {
+            run_callback();
+        }
+    }
+
+    // 回调可能释放最后一个引用，先移到栈上再执行
+    void run_callback() {
+        Task callback(std::move(callback_));
+        callback();
+    }
+
+    void recycle() {
+        if (has_value_) {
+            value().~Stored();
+            has_value_ = false;
+        }
+        error_ = nullptr;
+        callback_.reset();
+        FreeList& list = free_list();
+        if (list.size < kFreeListLimit) {
+            next_free_ = list.head;
+            list.head = this;
+            ++list.size;
+        } else {
+            delete this;
+        }
+    }
+
+    std::atomic<unsigned> flags_;
+    std::atomic<unsigned> refs_;
+    typename std::aligned_storage<sizeof(Stored), alignof(Stored)>::type storage_;
+    bool has_value_;
+    std::exception_ptr error_;
+    Task callback_;
+    SharedState* next_free_;
+};
+
+template<class T> class ForwardToStd;
+struct FutureAccess;
+
+} // namespace threadpool_detail
+
+template<class T> class Promise;
+class ThreadPool;
+
+// 线程池原生的 future：共享状态来自线程本地的回收链表，get() 先自旋再挂起。
+// 需要 std::future 的调用方可以直接转换（会额外建立一个 std::promise）
+template<class T>
+class Future {
+public:
+    Future() noexcept : state_(nullptr) {}
+
+    Future(Future&& other) noexcept : state_(other.state_) {
+        other.state_ = nullptr;
+    }
+
+    Future& operator=(Future&& other) noexcept {
+        if (this != &other) {
+            reset();
+            state_ = other.state_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    ~Future() { reset(); }
+
+    bool valid() const noexcept { return state_ != nullptr; }
+
+    bool is_ready() const {
+        check_state();
+        return state_->is_ready();
+    }
+
+    void wait() const {
+        check_state();
+        state_->wait();
+    }
+
+    template<class Rep, class Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        check_state();
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        return state_->wait_until(deadline) ? std::future_status::ready : std::future_status::timeout;
+    }
+
+    // 取走结果后 Future 失效，共享状态随即回收
+    T get() {
+        check_state();
+        state_->wait();
+        StateGuard guard(state_);
+        state_ = nullptr;
+        if (guard.state->error()) {
+            std::rethrow_exception(guard.state->error());
+        }
+        return threadpool_detail::StoredType<T>::take(guard.state->value());
+    }
+
+    operator std::future<T>() && {
+        check_state();
+        std::promise<T> promise;
+        std::future<T> result = promise.get_future();
+        State* state = state_;
+        state_ = nullptr;
+        state->on_ready(Task(threadpool_detail::ForwardToStd<T>(state, std::move(promise))));
+        return result;
+    }
+
+    // 结果就绪后把 f(就绪的 Future<T>) 投递到 pool 执行，不阻塞任何线程；调用后本 Future 失效。
+    // f 里对参数调用 get() 不会等待，前驱的异常也由它处理；f 的返回值或异常写入返回的 Future
+    template<class F>
+    auto then(ThreadPool& pool, F&& f)
+        -> Future<typename std::result_of<typename std::decay<F>::type(Future<T>)>::type>;
+
+private:
+    typedef threadpool_detail::SharedState<T> State;
+    friend class Promise<T>;
+    friend struct threadpool_detail::FutureAccess;
+
+    struct StateGuard {
+        State* state;
+        explicit StateGuard(State* s) : state(s) {}
+        ~StateGuard() { state->release(); }
+    };
+
+    explicit Future(State* state) noexcept : state_(state) {}
+
+    void check_state() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    void reset() {
+        if (state_) {
+            state_->release();
+            state_ = nullptr;
+        }
+    }
+
+    State* state_;
+};
+
+template<class T>
+class Promise {
+public:
+    Promise() : state_(State::create()), future_retrieved_(false), satisfied_(false) {}
+
+    Promise(Promise&& other) noexcept
+        : state_(other.state_), future_retrieved_(other.future_retrieved_), satisfied_(other.satisfied_) {
+        other.state_ = nullptr;
+    }
+
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            state_ = other.state_;
+            future_retrieved_ = other.future_retrieved_;
+            satisfied_ = other.satisfied_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    Promise(const Promise&) = delete;
+    Promise& operator=(const Promise&) = delete;
+
+    ~Promise() { abandon(); }
+
+    Future<T> get_future() {
+        check_state();
+        if (future_retrieved_) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        future_retrieved_ = true;
+        return Future<T>(state_);
+    }
+
+    template<class... A>
+    void set_value(A&&... a) {
+        check_unsatisfied();
+        satisfied_ = true;
+        state_->set_value(std::forward<A>(a)...);
+    }
+
+    void set_exception(std::exception_ptr e) {
+        check_unsatisfied();
+        satisfied_ = true;
+        state_->set_exception(std::move(e));
+    }
+
+private:
+    typedef threadpool_detail::SharedState<T> State;
+
+    void check_state() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    void check_unsatisfied() const {
+        check_state();
+        if (satisfied_) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    // 未兑现就被销毁的 Promise 以 broken_promise 通知等待方
+    void abandon() {
+        if (!state_) {
+            return;
+        }
+        if (!satisfied_) {
+            state_->set_exception(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+        }
+        if (!future_retrieved_) {
+            state_->release();
+        }
+        state_->release();
+        state_ = nullptr;
+    }
+
+    State* state_;
+    bool future_retrieved_;
+    bool satisfied_;
+};
+
+namespace threadpool_detail {
+
+// 把 Future 的结果转交给 std::promise，用于向 std::future 的转换
+template<class T>
+class ForwardToStd {
+public:
+    ForwardToStd(SharedState<T>* state, std::promise<T>&& promise)
+        : state_(state), promise_(std::move(promise)) {}
+
+    void operator()() {
+        if (state_->error()) {
+            promise_.set_exception(state_->error());
+        } else {
+            deliver(std::is_void<T>());
+        }
+        state_->release();
+    }
+
+private:
+    void deliver(std::true_type) { promise_.set_value(); }
+    void deliver(std::false_type) { promise_.set_value(StoredType<T>::take(state_->value())); }
+
+    SharedState<T>* state_;
+    std::promise<T> promise_;
+};
+
+// 执行任务并把结果或异常写入 Promise
+template<class R, class Fn>
+struct PromiseTask {
+    Promise<R> promise;
+    Fn fn;
+
+    PromiseTask(Promise<R>&& p, Fn&& f) : promise(std::move(p)), fn(std::move(f)) {}
+
+    void operator()() {
+        try {
+            fulfil(std::is_void<R>());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    void fulfil(std::true_type) { fn(); promise.set_value(); }
+    void fulfil(std::false_type) { promise.set_value(fn()); }
+};
+
+// 批量任务的共享状态：一个原子计数器跟踪整批完成，最后完成的任务兑现 Promise 并释放状态
+template<class Body>
+struct BulkState {
+    Body body;
+    std::atomic<size_t> remaining;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+    Promise<void> promise;
+
+    BulkState(Body&& b, size_t n) : body(std::move(b)), remaining(n), failed(false) {}
+
+    // 一旦有任务抛出异常，其余尚未开始的任务直接跳过
+    template<class Cursor>
+    void run(Cursor& cursor, size_t index) {
+        if (!failed.load(std::memory_order_relaxed)) {
+            try {
+                body(cursor, index);
+            } catch (...) {
+                if (!failed.exchange(true)) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        finish();
+    }
+
+    // 任务被丢弃而未执行时也要计数，否则整批的 Future 永远不会就绪
+    void abandon() {
+        if (!failed.exchange(true)) {
+            error = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+        }
+        finish();
+    }
+
+    void finish() {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (error) {
+                promise.set_exception(error);
+            } else {
+                promise.set_value();
+            }
+            delete this;
+        }
+    }
+};
+
+template<class State, class Cursor>
+class BulkTask {
+public:
+    BulkTask(State* state, Cursor cursor, size_t index)
+        : state_(state), cursor_(cursor), index_(index) {}
+
+    BulkTask(BulkTask&& other) noexcept
+        : state_(other.state_), cursor_(std::move(other.cursor_)), index_(other.index_) {
+        other.state_ = nullptr;
+    }
+
+    BulkTask(const BulkTask&) = delete;
+    BulkTask& operator=(const BulkTask&) = delete;
+
+    ~BulkTask() {
+        if (state_) {
+            state_->abandon();
+        }
+    }
+
+    void operator()() {
+        State* state = state_;
+        state_ = nullptr;
+        state->run(cursor_, index_);
+    }
+
+private:
+    State* state_;
+    Cursor cursor_;
+    size_t index_;
+};
+
+// submit_n：对下标调用 fn(i)
+template<class F>
+struct IndexBody {
+    F fn;
+    void operator()(size_t, size_t i) { fn(i); }
+};
+
+template<class F, class Out>
+struct IndexOutBody {
+    F fn;
+    Out out;
+    void operator()(size_t, size_t i) { out[i] = fn(i); }
+};
+
+// submit_bulk：对区间元素调用 fn(*it)
+template<class F>
+struct ElementBody {
+    F fn;
+    template<class It>
+    void operator()(It& it, size_t) { fn(*it); }
+};
+
+template<class F, class Out>
+struct ElementOutBody {
+    F fn;
+    Out out;
+    template<class It>
+    void operator()(It& it, size_t i) { out[i] = fn(*it); }
+};
+
+static const size_t kCacheLine = 64;
+
+// C++11 的 operator new 不保证超过 alignof(max_align_t) 的对齐，按缓存行对齐的对象手动对齐：
+// 多申请 align 字节，把原始指针存在对齐地址之前
+inline void* aligned_allocate(size_t size, size_t align) {
+    void* raw = ::operator new(size + align + sizeof(void*));
+    uintptr_t base = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    void* aligned = reinterpret_cast<void*>((base + align - 1) & ~(static_cast<uintptr_t>(align) - 1));
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return aligned;
+}
+
+// 单写者计数器：只有拥有者线程写入，用 load + store 代替原子加，其他线程可随时无锁读取
+inline void add_relaxed(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+inline void aligned_deallocate(void* p) {
+    if (p) {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+}
+
+// 每个参与者独占的累加槽，后接一整条缓存行的填充，避免相邻槽位伪共享
+template<class T>
+struct PaddedValue {
+    T value;
+    char pad[kCacheLine];
+    explicit PaddedValue(const T& v) : value(v) {}
+};
+
+// 并行循环的共享调度状态。参与者（调用线程 + 若干工作线程）用 CAS 从游标领取块，
+// 块大小为 剩余量 / (2 * 参与者数)，随剩余量递减（guided 调度），
+// 整个循环只需要参与者数量个任务，而不是每个迭代一个任务
+template<class ChunkFn>
+class LoopState {
+public:
+    LoopState(size_t total, size_t participants, size_t min_chunk, ChunkFn fn)
+        : fn_(std::move(fn)), total_(total), participants_(participants),
+          min_chunk_(std::max<size_t>(min_chunk, 1)),
+          cursor_(0), done_(0), next_slot_(0), failed_(false) {}
+
+    // 领取参与者编号，对应一个累加槽
+    size_t join() {
+        return next_slot_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void participate(size_t slot) {
+        size_t lo, hi;
+        while (claim(lo, hi)) {
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    fn_(slot, lo, hi);
+                } catch (...) {
+                    fail();
+                }
+            }
+            complete(hi - lo);
+        }
+    }
+
+    // 调用线程做完自己能领到的块后，只需等待其他参与者手上正在执行的块
+    void wait() {
+        for (int i = 0; i < 64 && !finished(); ++i) {
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return finished(); });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    bool finished() const {
+        return done_.load(std::memory_order_acquire) == total_;
+    }
+
+    bool claim(size_t& lo, size_t& hi) {
+        size_t cur = cursor_.load(std::memory_order_relaxed);
+        while (cur < total_) {
+            size_t chunk = std::max(min_chunk_, (total_ - cur) / (2 * participants_));
+            size_t next = std::min(total_, cur + chunk);
+            if (cursor_.compare_exchange_weak(cur, next, std::memory_order_relaxed)) {
+                lo = cur;
+                hi = next;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 第一个异常被保存，尚未领取的迭代直接记为完成
+    void fail() {
+        if (!failed_.exchange(true)) {
+            error_ = std::current_exception();
+        }
+        size_t old = cursor_.exchange(total_);
+        if (old < total_) {
+            complete(total_ - old);
+        }
+    }
+
+    void complete(size_t n) {
+        if (done_.fetch_add(n, std::memory_order_acq_rel) + n == total_) {
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            cv_.notify_all();
+        }
+    }
+
+    ChunkFn fn_;
+    const size_t total_;
+    const size_t participants_;
+    const size_t min_chunk_;
+    std::atomic<size_t> cursor_;
+    std::atomic<size_t> done_;
+    std::atomic<size_t> next_slot_;
+    std::atomic<bool> failed_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// 投递给工作线程的参与者任务；晚到的任务发现游标已耗尽会立即返回
+template<class State>
+struct LoopHelper {
+    std::shared_ptr<State> state;
+    void operator()() { state->participate(state->join()); }
+};
+
+template<class Index, class Body>
+struct ForChunk {
+    Index begin;
+    Body* body;
+    void operator()(size_t, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            (*body)(static_cast<Index>(begin + static_cast<Index>(i)));
+        }
+    }
+};
+
+template<class Index, class T, class Map, class Combine>
+struct ReduceChunk {
+    Index begin;
+    Map* map;
+    Combine* combine;
+    std::vector<PaddedValue<T>>* slots;
+    void operator()(size_t slot, size_t lo, size_t hi) {
+        T& acc = (*slots)[slot].value;
+        for (size_t i = lo; i < hi; ++i) {
+            acc = (*combine)(std::move(acc), (*map)(static_cast<Index>(begin + static_cast<Index>(i))));
+        }
+    }
+};
+
+} // namespace threadpool_detail
+
+// 任务优先级：数值越小越优先
+enum class TaskPriority : unsigned char {
+    high = 0,
+    normal = 1,
+    low = 2,
+    background = 3
+};
+
+// 单个优先级的队列统计快照
+struct PriorityLevelStats {
+    size_t depth;            // 当前排队数
+    uint64_t enqueued;       // 累计入队数
+    uint64_t dequeued;       // 累计出队数
+    uint64_t total_wait_ns;  // 出队任务的累计排队时间
+    uint64_t max_wait_ns;    // 出队任务的最长排队时间
+};
+
+namespace threadpool_detail {
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 多级优先队列：每级一个 FIFO，入队 O(1)，出队只看各级队首 O(级数)。
+// 各级按权重加权轮转（高级别每轮拿到更多次出队机会），低优先级不会被饿死。
+// 本身不加锁，由调用方（queue_mutex_）保护；统计计数是原子的，可无锁读取
+class PriorityTaskQueue {
+public:
+    static const size_t kLevels = 4;
+
+    PriorityTaskQueue() : size_(0) {
+        for (size_t i = 0; i < kLevels; ++i) {
+            credits_[i] = weight(i);
+            depth_[i].store(0, std::memory_order_relaxed);
+            enqueued_[i].store(0, std::memory_order_relaxed);
+            dequeued_[i].store(0, std::memory_order_relaxed);
+            total_wait_[i].store(0, std::memory_order_relaxed);
+            max_wait_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // 每轮各级可出队的次数：8 / 4 / 2 / 1
+    static unsigned weight(size_t level) {
+        return 1u << (kLevels - 1 - level);
+    }
+
+    void push(Task&& task, size_t level, int64_t now) {
+        levels_[level].push_back(Entry(std::move(task), now));
+        ++size_;
+        depth_[level].store(levels_[level].size(), std::memory_order_relaxed);
+        enqueued_[level].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 按加权轮转选出一级并弹出队首；level 返回被选中的级别
+    bool pop(Task& task, int64_t now, size_t& level) {
+        if (size_ == 0) {
+            return false;
+        }
+        level = select_level();
+        pop_level(level, task, now);
+        return true;
+    }
+
+    // 从指定级别弹出队首（用于同级批量搬运）
+    bool pop_level(size_t level, Task& task, int64_t now) {
+        std::deque<Entry>& q = levels_[level];
+        if (q.empty()) {
+            return false;
+        }
+        uint64_t wait = static_cast<uint64_t>(std::max<int64_t>(0, now - q.front().enqueued_ns));
+        task = std::move(q.front().task);
+        q.pop_front();
+        --size_;
+        depth_[level].store(q.size(), std::memory_order_relaxed);
+        dequeued_[level].fetch_add(1, std::memory_order_relaxed);
+        total_wait_[level].fetch_add(wait, std::memory_order_relaxed);
+        if (wait > max_wait_[level].load(std::memory_order_relaxed)) {
+            max_wait_[level].store(wait, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // 丢弃最低优先级中最老的任务（用于 discard_oldest 拒绝策略），不计入排队统计
+    bool pop_oldest_lowest(Task& task) {
+        for (size_t i = kLevels; i-- > 0;) {
+            std::deque<Entry>& q = levels_[i];
+            if (!q.empty()) {
+                task = std::move(q.front().task);
+                q.pop_front();
+                --size_;
+                depth_[i].store(q.size(), std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t level_size(size_t level) const { return levels_[level].size(); }
+
+    // 无锁读取
+    size_t depth(size_t level) const {
+        return depth_[level].load(std::memory_order_relaxed);
+    }
+
+    PriorityLevelStats stats(size_t level) const {
+        PriorityLevelStats result;
+        result.depth = depth_[level].load(std::memory_order_relaxed);
+        result.enqueued = enqueued_[level].load(std::memory_order_relaxed);
+        result.dequeued = dequeued_[level].load(std::memory_order_relaxed);
+        result.total_wait_ns = total_wait_[level].load(std::memory_order_relaxed);
+        result.max_wait_ns = max_wait_[level].load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    struct Entry {
+        Task task;
+        int64_t enqueued_ns;
+        Entry(Task&& t, int64_t now) : task(std::move(t)), enqueued_ns(now) {}
+    };
+
+    // 取仍有额度的最高非空级别；所有非空级别额度用完则开始新一轮
+    size_t select_level() {
+        for (int round = 0; round < 2; ++round) {
+            for (size_t i = 0; i < kLevels; ++i) {
+                if (!levels_[i].empty() && credits_[i] > 0) {
+                    --credits_[i];
+                    return i;
+                }
+            }
+            for (size_t i = 0; i < kLevels; ++i) {
+                credits_[i] = weight(i);
+            }
+        }
+        return 0; // size_ > 0 时不会到达
+    }
+
+    std::deque<Entry> levels_[kLevels];
+    unsigned credits_[kLevels];
+    size_t size_;
+    std::atomic<size_t> depth_[kLevels];
+    std::atomic<uint64_t> enqueued_[kLevels];
+    std::atomic<uint64_t> dequeued_[kLevels];
+    std::atomic<uint64_t> total_wait_[kLevels];
+    std::atomic<uint64_t> max_wait_[kLevels];
+};
+
+} // namespace threadpool_detail
+
+// 队列满时的拒绝策略，对应 Java ThreadPoolExecutor 的 RejectedExecutionHandler
+enum class RejectionPolicy {
+    block,            // 阻塞提交方，直到队列有空位
+    caller_runs,      // 在提交线程上直接执行
+    discard_oldest,   // 丢弃最低优先级中最老的排队任务，再入队新任务
+    throw_exception   // 抛出 TaskRejectedError
+};
+
+// 任务被拒绝时抛出
+class TaskRejectedError : public std::runtime_error {
+public:
+    explicit TaskRejectedError(const std::string& what) : std::runtime_error(what) {}
+};
+
+// 外部线程提交普通优先级任务时使用的全局队列
+enum class SubmitQueue {
+    mutex,      // 互斥锁保护的分级队列
+    lock_free   // 有界无锁环形队列（MpmcQueue），满时退回互斥队列
+};
+
+// 工作线程状态（v1.0 ThreadStatus 的延续）
+enum class ThreadStatus {
+    idle,       // 在找任务（自旋/让出）
+    busy,       // 正在执行任务
+    parked,     // 已挂起等待唤醒
+    stopped     // 已退出
+};
+
+// get_worker_info() 返回的每线程快照
+struct WorkerInfo {
+    std::thread::id id;
+    ThreadStatus status;
+    uint64_t tasks_executed;
+    size_t local_queue_size;
+    int cpu;                 // 绑定的 CPU，-1 表示未绑核
+    size_t node;             // 所属 NUMA 节点
+};
+
+// 单个工作线程槽位的累计计数（槽位复用时继续累加）
+struct WorkerStats {
+    size_t slot;
+    bool active;                 // 槽位当前是否有线程
+    ThreadStatus status;
+    size_t local_queue_size;
+    uint64_t tasks_executed;
+    uint64_t busy_ns;            // 连续执行任务的累计时间
+    uint64_t idle_ns;            // 找任务、自旋和挂起的累计时间
+    uint64_t steals;             // 从其他线程窃取到的任务数
+    uint64_t wakeups;            // 从挂起中被唤醒的次数
+    uint64_t spurious_wakeups;   // 被唤醒后没有取到任务的次数
+};
+
+// ThreadPool::stats() 返回的快照，全部来自原子变量，不加 queue_mutex_
+struct PoolStats {
+    size_t threads;
+    size_t idle_threads;         // 已挂起的线程数
+    size_t queued_tasks;
+    uint64_t rejected_tasks;
+    uint64_t discarded_tasks;
+    uint64_t tasks_executed;     // 以下为各槽位之和
+    uint64_t busy_ns;
+    uint64_t idle_ns;
+    uint64_t steals;
+    uint64_t wakeups;
+    uint64_t spurious_wakeups;
+    std::vector<WorkerStats> workers;
+};
+
+// 把快照格式化为 Prometheus 文本格式，可直接作为 /metrics 响应体
+inline std::string to_prometheus(const PoolStats& stats, const std::string& pool = "default") {
+    std::ostringstream out;
+    std::string label = "pool=\"" + pool + "\"";
+    auto gauge = [&](const char* name, const char* help, uint64_t value) {
+        out << "# HELP threadpool_" << name << " " << help << "\n"
+            << "# TYPE threadpool_" << name << " gauge\n"
+            << "threadpool_" << name << "{" << label << "} " << value << "\n";
+    };
+    auto counter = [&](const char* name, const char* help, uint64_t value) {
+        out << "# HELP threadpool_" << name << " " << help << "\n"
+            << "# TYPE threadpool_" << name << " counter\n"
+            << "threadpool_" << name << "{" << label << "} " << value << "\n";
+    };
+    // 每个槽位一条，带 worker 标签；seconds 为 true 时把纳秒换算成秒
+    auto per_worker = [&](const char* name, const char* help, uint64_t WorkerStats::*field, bool seconds) {
+        out << "# HELP threadpool_worker_" << name << " " << help << "\n"
+            << "# TYPE threadpool_worker_" << name << " counter\n";
+        for (const WorkerStats& w : stats.workers) {
+            out << "threadpool_worker_" << name << "{" << label << ",worker=\"" << w.slot << "\"} ";
+            if (seconds) {
+                out << static_cast<double>(w.*field) / 1e9;
+            } else {
+                out << w.*field;
+            }
+            out << "\n";
+        }
+    };
+
+    gauge("threads", "Current number of worker threads.", stats.threads);
+    gauge("idle_threads", "Worker threads parked waiting for work.", stats.idle_threads);
+    gauge("queued_tasks", "Tasks queued but not yet started.", stats.queued_tasks);
+    counter("rejected_tasks_total", "Tasks rejected because the queue was full.", stats.rejected_tasks);
+    counter("discarded_tasks_total", "Queued tasks dropped by the discard_oldest policy.", stats.discarded_tasks);
+    counter("tasks_executed_total", "Tasks executed by all workers.", stats.tasks_executed);
+    per_worker("tasks_executed_total", "Tasks executed by this worker slot.", &WorkerStats::tasks_executed, false);
+    per_worker("busy_seconds_total", "Time this worker slot spent running tasks.", &WorkerStats::busy_ns, true);
+    per_worker("idle_seconds_total", "Time this worker slot spent looking for work or parked.", &WorkerStats::idle_ns, true);
+    per_worker("steals_total", "Tasks this worker slot stole from other workers.", &WorkerStats::steals, false);
+    per_worker("wakeups_total", "Times this worker slot was unparked.", &WorkerStats::wakeups, false);
+    per_worker("spurious_wakeups_total", "Wakeups that found no task.", &WorkerStats::spurious_wakeups, false);
+    return out.str();
+}
+
+namespace threadpool_detail {
+class HistogramRecorder;
+}
+
+// 对数分桶的延迟直方图（HDR 风格）：每个 2 的幂区间再均分 16 个子桶，相对误差约 6%，
+// 覆盖 1 ns ~ 2^41 ns（约 36 分钟），更大的值计入最后一个桶。数值单位为纳秒
+class LatencyHistogram {
+public:
+    static const size_t kSubBucketBits = 4;
+    static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static const size_t kMaxExponent = 40;
+    static const size_t kBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    LatencyHistogram() : buckets_(kBuckets, 0), count_(0), sum_(0), max_(0) {}
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        size_t exponent = highest_bit(value);
+        if (exponent > kMaxExponent) {
+            return kBuckets - 1;
+        }
+        size_t sub = static_cast<size_t>(value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+    }
+
+    // 桶内最大值，百分位按它报告（偏保守）
+    static uint64_t bucket_upper(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        size_t exponent = index / kSubBuckets + kSubBucketBits - 1;
+        uint64_t sub = index % kSubBuckets;
+        uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+        return ((kSubBuckets + sub) << (exponent - kSubBucketBits)) + width - 1;
+    }
+
+    void record(uint64_t value) {
+        buckets_[bucket_index(value)]++;
+        count_++;
+        sum_ += value;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    // q 取 [0, 1]，例如 0.99；没有样本时返回 0
+    uint64_t percentile(double q) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * count_);
+        rank = std::min<uint64_t>(std::max<uint64_t>(rank, 1), count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return std::min(bucket_upper(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t p50() const { return percentile(0.5); }
+    uint64_t p99() const { return percentile(0.99); }
+    uint64_t p999() const { return percentile(0.999); }
+
+private:
+    friend class threadpool_detail::HistogramRecorder;
+
+    static size_t highest_bit(uint64_t value) {
+#if defined(__GNUC__)
+        return 63 - static_cast<size_t>(__builtin_clzll(value));
+#else
+        size_t bit = 0;
+        while (value >>= 1) {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+// ThreadPool::latency() 的返回值：各工作线程的直方图合并而成
+struct LatencyStats {
+    LatencyHistogram queue_wait;   // 入队到开始执行
+    LatencyHistogram execution;    // 执行耗时
+};
+
+namespace threadpool_detail {
+
+// 工作线程私有的直方图：只有拥有者写入（不用原子加），读取方随时合并
+class HistogramRecorder {
+public:
+    HistogramRecorder() {
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            buckets_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(uint64_t value) {
+        add_relaxed(buckets_[LatencyHistogram::bucket_index(value)], 1);
+        add_relaxed(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void merge_into(LatencyHistogram& out) const {
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+            out.buckets_[i] += n;
+            out.count_ += n;
+        }
+        out.sum_ += sum_.load(std::memory_order_relaxed);
+        out.max_ = std::max(out.max_, max_.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[LatencyHistogram::kBuckets];
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+enum class TraceKind : unsigned char { task, parked, scale };
+
+// 一条追踪记录：task / parked 为一段时间，scale 为一个时刻（begin_ns == end_ns）
+struct TraceRecord {
+    TraceKind kind;
+    const char* name;       // task 的用户标签，未设置时为 nullptr
+    int64_t begin_ns;
+    int64_t end_ns;
+    int64_t queued_ns;      // task 的入队时间
+    size_t from;            // scale 前后的线程数
+    size_t to;
+};
+
+// 单写者追踪缓冲：容量固定，写满后丢弃新记录，已写入的记录不再改动；
+// 读取方按已发布的长度读取，与写入方之间没有锁
+class TraceBuffer {
+public:
+    explicit TraceBuffer(size_t capacity) : records_(capacity), size_(0), dropped_(0) {}
+
+    void push(const TraceRecord& record) {
+        size_t n = size_.load(std::memory_order_relaxed);
+        if (n == records_.size()) {
+            add_relaxed(dropped_, 1);
+            return;
+        }
+        records_[n] = record;
+        size_.store(n + 1, std::memory_order_release);
+    }
+
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    const TraceRecord& operator[](size_t i) const { return records_[i]; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<TraceRecord> records_;
+    std::atomic<size_t> size_;
+    std::atomic<uint64_t> dropped_;
+};
+
+} // namespace threadpool_detail
+
+// 自动扩缩容控制器的一次决策，通过 set_scale_callback 设置的回调通知
+struct ScaleEvent {
+    size_t old_threads;
+    size_t new_threads;
+    size_t queue_depth;      // 决策时的排队任务数
+    double avg_wait_us;      // 本采样周期内从全局队列取出的任务的平均排队时间
+    double utilization;      // 平滑后的工作线程利用率（0~1）
+};
+
+// 线程池生命周期事件
+enum class PoolEventType {
+    started,         // 构造完成；threads = min_threads，count = max_threads
+    threads_spawned, // 扩容；count 个新线程，threads 为扩容后的线程数
+    threads_retired, // 缩容；count 个线程开始退休，threads 为缩容后的线程数
+    tasks_rejected,  // 上次投递以来 count 个任务因队列已满被拒绝（按周期合并）
+    tasks_discarded, // 上次投递以来 count 个排队任务被 discard_oldest 丢弃（按周期合并）
+    shutdown         // 析构完成，所有工作线程已退出
+};
+
+struct PoolEvent {
+    PoolEventType type;
+    int64_t time_ns;     // steady_clock 时间戳
+    size_t threads;
+    size_t count;
+};
+
+// 事件接收者。线程池在产生事件的线程上只把事件写入无锁环形队列，
+// 由后台控制器线程（以及析构函数）批量取出后调用 on_event，on_event 不会并发调用
+class PoolEventSink {
+public:
+    virtual ~PoolEventSink() {}
+    virtual void on_event(const PoolEvent& event) = 0;
+};
+
+// 控制台接收者：把事件打印到 std::cout（与原来直接打印的内容一致）。
+// 事件由控制器线程异步投递，输出与工作线程上的任务没有先后保证
+class ConsoleEventSink : public PoolEventSink {
+public:
+    void on_event(const PoolEvent& event) override {
+        switch (event.type) {
+        case PoolEventType::started:
+            std::cout << "ThreadPool initialized with " << event.threads << " threads, max: " << event.count << std::endl;
+            break;
+        case PoolEventType::threads_spawned:
+            std::cout << "Dynamic expansion: " << event.count << " thread(s) created. Total: " << event.threads << std::endl;
+            break;
+        case PoolEventType::threads_retired:
+            std::cout << "Scaling down: " << event.count << " thread(s) retiring. Total: " << event.threads << std::endl;
+            break;
+        case PoolEventType::tasks_rejected:
+            std::cout << "ThreadPool: " << event.count << " task(s) rejected, queue is full" << std::endl;
+            break;
+        case PoolEventType::tasks_discarded:
+            std::cout << "ThreadPool: " << event.count << " queued task(s) discarded" << std::endl;
+            break;
+        case PoolEventType::shutdown:
+            std::cout << "ThreadPool destroyed successfully." << std::endl;
+            break;
+        }
+    }
+};
+
+// 工作线程绑核策略
+enum class AffinityPolicy {
+    none,           // 不绑核，由操作系统调度
+    compact,        // 依次占满一个 NUMA 节点（同一物理核的超线程相邻）再用下一个
+    scatter,        // 在各节点之间轮流分配，节点内先分散到不同物理核
+    explicit_cpus   // 按 ThreadPoolOptions::affinity_cpus 依次绑定（线程数多于列表时循环使用）
+};
+
+namespace threadpool_detail {
+
+struct CpuInfo {
+    int cpu;
+    int core;       // topology/core_id
+    int package;    // topology/physical_package_id
+    size_t node;    // 所在 NUMA 节点
+};
+
+// 从 sysfs 读取的 CPU 拓扑；读取失败时退化为单节点、每个逻辑 CPU 一个物理核
+struct CpuTopology {
+    std::vector<CpuInfo> cpus;
+    size_t nodes = 1;
+
+    size_t node_of(int cpu) const {
+        for (const CpuInfo& info : cpus) {
+            if (info.cpu == cpu) {
+                return info.node;
+            }
+        }
+        return 0;
+    }
+};
+
+// 解析 "0-3,8,10-11" 形式的 CPU/节点列表
+inline bool read_id_list(const std::string& path, std::vector<int>& out) {
+    std::ifstream in(path.c_str());
+    std::string text;
+    if (!std::getline(in, text)) {
+        return false;
+    }
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty() || item == "\n") {
+            continue;
+        }
+        size_t dash = item.find('-');
+        int first = std::atoi(item.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+        for (int id = first; id <= last; ++id) {
+            out.push_back(id);
+        }
+    }
+    return !out.empty();
+}
+
+inline int read_int(const std::string& path, int fallback) {
+    std::ifstream in(path.c_str());
+    int value;
+    return in >> value ? value : fallback;
+}
+
+// root 默认为 /sys/devices/system，可指向按同样布局构造的目录
+inline CpuTopology load_topology(const std::string& root = "/sys/devices/system") {
+    CpuTopology topology;
+    std::vector<int> online;
+    if (!read_id_list(root + "/cpu/online", online)) {
+        for (unsigned i = 0; i < cpu_count(); ++i) {
+            online.push_back(static_cast<int>(i));
+        }
+    }
+    for (int cpu : online) {
+        std::string dir = root + "/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        CpuInfo info = { cpu, read_int(dir + "core_id", cpu), read_int(dir + "physical_package_id", 0), 0 };
+        topology.cpus.push_back(info);
+    }
+
+    std::vector<int> nodes;
+    read_id_list(root + "/node/online", nodes);
+    for (int node : nodes) {
+        std::vector<int> members;
+        read_id_list(root + "/node/node" + std::to_string(node) + "/cpulist", members);
+        for (int cpu : members) {
+            for (CpuInfo& info : topology.cpus) {
+                if (info.cpu == cpu) {
+                    info.node = static_cast<size_t>(node);
+                }
+            }
+        }
+        topology.nodes = std::max(topology.nodes, static_cast<size_t>(node) + 1);
+    }
+    return topology;
+}
+
+inline const CpuTopology& cpu_topology() {
+    static const CpuTopology topology = load_topology();
+    return topology;
+}
+
+// 为 workers 个槽位选定 CPU，-1 表示不绑核
+inline std::vector<int> plan_affinity(const CpuTopology& topology, AffinityPolicy policy,
+                                      const std::vector<int>& explicit_cpus, size_t workers) {
+    std::vector<int> plan(workers, -1);
+    if (policy == AffinityPolicy::none || topology.cpus.empty()) {
+        return plan;
+    }
+    if (policy == AffinityPolicy::explicit_cpus) {
+        for (size_t i = 0; i < workers && !explicit_cpus.empty(); ++i) {
+            plan[i] = explicit_cpus[i % explicit_cpus.size()];
+        }
+        return plan;
+    }
+
+    // 同一物理核上的第几个超线程：scatter 先用完各核的第一个超线程
+    std::vector<std::pair<size_t, CpuInfo>> ranked;
+    for (const CpuInfo& info : topology.cpus) {
+        size_t sibling = 0;
+        for (const CpuInfo& other : topology.cpus) {
+            if (other.package == info.package && other.core == info.core && other.cpu < info.cpu) {
+                ++sibling;
+            }
+        }
+        ranked.push_back(std::make_pair(sibling, info));
+    }
+    bool compact = policy == AffinityPolicy::compact;
+    std::sort(ranked.begin(), ranked.end(),
+              [compact](const std::pair<size_t, CpuInfo>& a, const std::pair<size_t, CpuInfo>& b) {
+        const CpuInfo& x = a.second;
+        const CpuInfo& y = b.second;
+        if (x.node != y.node) {
+            return x.node < y.node;
+        }
+        if (!compact && a.first != b.first) {
+            return a.first < b.first;
+        }
+        return std::make_tuple(x.package, x.core, x.cpu) < std::make_tuple(y.package, y.core, y.cpu);
+    });
+    if (compact) {
+        for (size_t i = 0; i < workers; ++i) {
+            plan[i] = ranked[i % ranked.size()].second.cpu;
+        }
+        return plan;
+    }
+
+    std::vector<std::vector<int>> per_node(topology.nodes);
+    for (const std::pair<size_t, CpuInfo>& entry : ranked) {
+        per_node[entry.second.node].push_back(entry.second.cpu);
+    }
+    per_node.erase(std::remove_if(per_node.begin(), per_node.end(),
+                                  [](const std::vector<int>& cpus) { return cpus.empty(); }), per_node.end());
+    for (size_t i = 0; i < workers; ++i) {
+        const std::vector<int>& cpus = per_node[i % per_node.size()];
+        plan[i] = cpus[i / per_node.size() % cpus.size()];
+    }
+    return plan;
+}
+
+// 把调用线程绑定到一个 CPU；不支持的平台或 CPU 不可用时返回 false
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// 调用线程当前所在的 CPU，未知时返回 -1
+inline int current_cpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+} // namespace threadpool_detail
+
+// 构造时如何启动工作线程
+enum class StartMode {
+    eager,      // 构造函数创建 min_threads 个线程后立即返回，不等它们就绪
+    lazy,       // 构造时不创建任何线程，第一次提交时才启动
+    prewarmed   // 构造函数等到 min_threads 个线程全部进入工作循环后才返回
+};
+
+// 线程池配置，对应 Java ThreadPoolExecutor 的构造参数
+struct ThreadPoolOptions {
+    size_t min_threads = std::thread::hardware_concurrency();
+    size_t max_threads = std::thread::hardware_concurrency() * 2;
+    std::chrono::milliseconds min_stable_time = std::chrono::seconds(5); // 扩缩容冷却期
+    size_t queue_capacity = 0;                                        // 排队任务上限，0 表示不限
+    RejectionPolicy rejection_policy = RejectionPolicy::block;
+    SubmitQueue submit_queue = SubmitQueue::mutex;
+    size_t submit_ring_capacity = 4096;                               // lock_free 时环形队列的容量
+    // 空闲策略：先自旋 idle_spins 次（单核机器跳过），再让出 idle_yields 次，最后在各自的停车位上挂起
+    size_t idle_spins = 1024;
+    size_t idle_yields = 4;
+    // 自动扩缩容（仅 max_threads > min_threads 时启动控制器线程）：
+    // 没有空闲线程且每线程排队数超过 scale_up_backlog 或平均排队时间超过 scale_up_wait 时扩容；
+    // 队列为空且利用率持续低于 scale_down_utilization 达 min_stable_time 后缩容
+    std::chrono::milliseconds scale_interval = std::chrono::milliseconds(20);
+    size_t scale_up_backlog = 16;
+    std::chrono::microseconds scale_up_wait = std::chrono::milliseconds(1);
+    double scale_down_utilization = 0.25;
+    StartMode start_mode = StartMode::eager;
+    // 生命周期事件接收者，默认为空：不记录事件，也不为投递事件启动控制器线程（固定大小的线程池没有后台线程）。
+    // 需要控制台输出时设为 std::make_shared<ConsoleEventSink>()；定义 THREADPOOL_DISABLE_EVENTS 时整套事件机制被编译掉
+    std::shared_ptr<PoolEventSink> event_sink;
+    // 记录每个任务的排队时间与执行时间直方图（每个任务多读两次时钟），通过 latency() 读取
+    bool latency_histograms = false;
+    // 每个工作线程（及控制器）的追踪缓冲容量（记录数），0 表示不追踪；写满后丢弃新记录。
+    // 通过 write_trace() 导出 Chrome Trace Event JSON
+    size_t trace_buffer_events = 0;
+    // 绑核与 NUMA：拓扑读取自 /sys/devices/system/{cpu,node}。每个 NUMA 节点一个提交队列，
+    // submit_on_node 直接投递；numa_local_submit 为 true 时，外部线程的普通任务进入提交线程所在节点的队列
+    AffinityPolicy affinity = AffinityPolicy::none;
+    std::vector<int> affinity_cpus;
+    bool numa_local_submit = false;
+    // 每个工作线程的任务内存池（WorkerArena）的块大小，0 表示不创建；第一次分配时才申请内存
+    size_t worker_arena_bytes = 64 * 1024;
+};
+
+// 资源组配置：各组在争用时按 weight 的比例分到执行时间；max_concurrency 限制本组同时执行的任务数，0 表示不限
+struct ResourceGroupOptions {
+    unsigned weight = 1;
+    size_t max_concurrency = 0;
+};
+
+// 资源组的计数快照
+struct ResourceGroupStats {
+    size_t queued;          // 排队中的任务数
+    size_t running;         // 正在执行的任务数
+    uint64_t executed;      // 累计执行完的任务数
+    uint64_t busy_ns;       // 累计执行时间
+};
+
+namespace threadpool_detail { struct GroupQueue; }
+
+// 线程池内的资源组（租户）：由 ThreadPool::group(name) 创建并归线程池所有，引用在线程池析构前一直有效。
+// 组内任务按提交顺序排队，不进入任何工作线程的本地队列，因此在工作线程内提交的组任务同样受权重与并发上限约束
+class ResourceGroup {
+public:
+    ResourceGroup(const ResourceGroup&) = delete;
+    ResourceGroup& operator=(const ResourceGroup&) = delete;
+
+    template<class F, class... Args>
+    auto submit(F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type>;
+
+    // 只执行、不关心结果；异常交给线程池的 set_exception_handler
+    template<class F, class... Args>
+    void post(F&& f, Args&&... args);
+
+    const std::string& name() const;
+    ResourceGroupStats stats() const;
+
+private:
+    friend struct threadpool_detail::GroupQueue;
+
+    ResourceGroup(ThreadPool* pool, threadpool_detail::GroupQueue* queue) : pool_(pool), queue_(queue) {}
+
+    ThreadPool* pool_;
+    threadpool_detail::GroupQueue* queue_;
+};
+
+namespace threadpool_detail {
+
+// 一个资源组的排队任务与调度状态，除 handle 外只在 GroupScheduler 的锁内访问
+struct GroupQueue {
+    GroupQueue(ThreadPool* pool, const std::string& group_name) : handle(pool, this), name(group_name) {}
+
+    ResourceGroup handle;
+    const std::string name;
+    unsigned weight = 1;
+    size_t max_concurrency = 0;
+    std::deque<Task, BlockAllocator<Task>> tasks;
+    size_t running = 0;
+    size_t held = 0;          // 受并发上限阻挡、计入 GroupScheduler::held_ 的排队任务数
+    int64_t pass = 0;         // 虚拟时间：累计执行时间 / 权重，越小越先调度
+    int64_t cost_ns = 0;      // 单个任务执行时间的平滑估计，出队时先按它记账
+    uint64_t executed = 0;
+    uint64_t busy_ns = 0;
+
+    bool capped() const { return max_concurrency != 0 && running >= max_concurrency; }
+};
+
+// 资源组之间的步幅调度：每组的虚拟时间按"执行时间 / 权重"前进，工作线程总是取虚拟时间最小、
+// 未达并发上限的非空组。出队时先按该组的平均执行时间记账，结束后按实际耗时修正，多个线程同时取任务时也会在组间交错。
+// 各组分到的执行时间与权重成正比，任务重或提交多的组挤不掉其他组；重新变为非空的组从当前虚拟时钟起步，空闲时不积攒额度。
+// 组数通常很少，出队时线性扫描
+class GroupScheduler {
+public:
+    GroupScheduler() : clock_(0), queued_(0), held_(0) {}
+
+    // 取得或创建名为 name 的组；options 非空时更新配置，released 返回因上限放宽而可以执行的任务数
+    GroupQueue& get(ThreadPool* pool, const std::string& name, const ResourceGroupOptions* options, size_t& released) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_ptr<GroupQueue>& group = groups_[name];
+        if (!group) {
+            group.reset(new GroupQueue(pool, name));
+            order_.push_back(group.get());
+        }
+        released = 0;
+        if (options) {
+            size_t before = group->held;
+            group->weight = std::max(1u, options->weight);
+            group->max_concurrency = options->max_concurrency;
+            update_held(*group);
+            released = before > group->held ? before - group->held : 0;
+        }
+        return *group;
+    }
+
+    // 入队；返回任务能否立即执行（所在组未达并发上限）
+    bool push(GroupQueue& group, Task&& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (group.tasks.empty()) {
+            group.pass = std::max(group.pass, clock_);
+        }
+        group.tasks.emplace_back(std::move(task));
+        queued_.fetch_add(1);
+        update_held(group);
+        return !group.capped();
+    }
+
+    // 取虚拟时间最小的可执行组的队首任务；charge 返回预先记入的执行时间，任务结束时交给 finish
+    bool pop(Task& task, GroupQueue*& out, int64_t& charge) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        GroupQueue* best = nullptr;
+        for (GroupQueue* group : order_) {
+            if (!group->tasks.empty() && !group->capped() && (!best || group->pass < best->pass)) {
+                best = group;
+            }
+        }
+        if (!best) {
+            return false;
+        }
+        task = std::move(best->tasks.front());
+        best->tasks.pop_front();
+        queued_.fetch_sub(1);
+        clock_ = best->pass;
+        charge = best->cost_ns;
+        best->pass += charge / best->weight;
+        ++best->running;
+        update_held(*best);
+        out = best;
+        return true;
+    }
+
+    // 任务结束：按实际耗时修正记账。因此解除阻挡的任务由结束它的工作线程接着去取，不另外唤醒
+    void finish(GroupQueue& group, int64_t charge, int64_t elapsed_ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        group.pass += (elapsed_ns - charge) / group.weight;
+        group.cost_ns = group.executed == 0 ? elapsed_ns : group.cost_ns + (elapsed_ns - group.cost_ns) / 8;
+        ++group.executed;
+        group.busy_ns += static_cast<uint64_t>(elapsed_ns);
+        --group.running;
+        update_held(group);
+    }
+
+    ResourceGroupStats stats(const GroupQueue& group) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ResourceGroupStats result;
+        result.queued = group.tasks.size();
+        result.running = group.running;
+        result.executed = group.executed;
+        result.busy_ns = group.busy_ns;
+        return result;
+    }
+
+    // 无锁提示：是否有不受上限阻挡的排队任务
+    bool has_runnable() const {
+        return queued_.load(std::memory_order_relaxed) > held_.load(std::memory_order_relaxed);
+    }
+
+    // 受并发上限阻挡的排队任务数。它们仍计入线程池的 pending_，空闲判断要把它们扣掉
+    size_t held() const {
+        return held_.load();
+    }
+
+private:
+    // 入队时先增加线程池的 pending_ 再增加 held_，读取方先读 held_ 再读 pending_，差值不会被低估
+    void update_held(GroupQueue& group) {
+        size_t held = group.capped() ? group.tasks.size() : 0;
+        if (held > group.held) {
+            held_.fetch_add(held - group.held);
+        } else if (held < group.held) {
+            held_.fetch_sub(group.held - held);
+        }
+        group.held = held;
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<GroupQueue>> groups_;
+    std::vector<GroupQueue*> order_;      // 按创建顺序，出队时遍历
+    int64_t clock_;                       // 最近一次出队时的虚拟时间
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> held_;
+};
+
+} // namespace threadpool_detail
+
+inline const std::string& ResourceGroup::name() const {
+    return queue_->name;
+}
+
+class TaskGraph;
+class TaskGroup;
+class TimerService;
+
+#if defined(__cpp_impl_coroutine)
+namespace coro { class ScheduleAwaitable; }
+#endif
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t min_threads = std::thread::hardware_concurrency(),
+                       size_t max_threads = std::thread::hardware_concurrency() * 2,
+                       std::chrono::milliseconds min_stable_time = std::chrono::seconds(5)) // 默认冷却期5秒
+        : ThreadPool(make_options(min_threads, max_threads, min_stable_time))
+    {}
+
+    explicit ThreadPool(const ThreadPoolOptions& options)
+        : shutdown_(false), min_threads_(options.min_threads),
+          max_threads_(std::max<size_t>(std::max(options.min_threads, options.max_threads), 1)),
+          min_stable_time_(options.min_stable_time), // 初始化最短稳定时间
+          queue_capacity_(options.queue_capacity), rejection_policy_(options.rejection_policy),
+          idle_spins_(threadpool_detail::cpu_count() > 1 ? options.idle_spins : 0),
+          idle_yields_(options.idle_yields),
+          scale_interval_(options.scale_interval), scale_up_backlog_(std::max<size_t>(options.scale_up_backlog, 1)),
+          scale_up_wait_(options.scale_up_wait), scale_down_utilization_(options.scale_down_utilization),
+          latency_histograms_(options.latency_histograms),
+          trace_capacity_(options.trace_buffer_events),
+          stamp_tasks_(options.latency_histograms || options.trace_buffer_events > 0),
+          trace_epoch_ns_(threadpool_detail::now_ns()),
+          numa_local_submit_(options.numa_local_submit)
+    {
+        if (options.submit_queue == SubmitQueue::lock_free) {
+            submit_ring_.reset(new MpmcQueue<Task>(options.submit_ring_capacity));
+        }
+        last_scale_time_ = std::chrono::steady_clock::now() - min_stable_time_; // 初始化时设置为"允许操作"
+        // 按最大线程数预分配每线程队列，窃取时无需加锁遍历 workers_；绑核方案按槽位固定
+        const threadpool_detail::CpuTopology& topology = threadpool_detail::cpu_topology();
+        std::vector<int> plan = threadpool_detail::plan_affinity(
+            topology, options.affinity, options.affinity_cpus, max_threads_);
+        for (size_t i = 0; i < topology.nodes; ++i) {
+            node_queues_.emplace_back(new NodeQueue());
+        }
+        slots_.reserve(max_threads_);
+        for (size_t i = 0; i < max_threads_; ++i) {
+            slots_.emplace_back(new WorkerSlot());
+            slots_.back()->cpu = plan[i];
+            slots_.back()->node = plan[i] >= 0 ? topology.node_of(plan[i]) : 0;
+            if (latency_histograms_) {
+                slots_.back()->queue_wait.reset(new threadpool_detail::HistogramRecorder());
+                slots_.back()->execution.reset(new threadpool_detail::HistogramRecorder());
+            }
+            if (trace_capacity_ != 0) {
+                slots_.back()->trace.reset(new threadpool_detail::TraceBuffer(trace_capacity_));
+            }
+            if (options.worker_arena_bytes != 0) {
+                slots_.back()->arena.reset(new WorkerArena(options.worker_arena_bytes));
+            }
+        }
+        if (trace_capacity_ != 0) {
+            controller_trace_.reset(new threadpool_detail::TraceBuffer(trace_capacity_));
+        }
+        idle_stack_.reserve(max_threads_); // 入栈在自旋锁内进行，不能在那里扩容
+#ifndef THREADPOOL_DISABLE_EVENTS
+        event_sink_ = options.event_sink;
+        if (event_sink_) {
+            events_.reset(new MpmcQueue<PoolEvent>(kEventCapacity));
+        }
+#endif
+
+        // 线程启动前提交的任务会留在队列里，线程一进入工作循环就会取走，因此 eager 不必等待
+        if (options.start_mode == StartMode::lazy) {
+            lazy_start_.store(true);
+        } else if (options.start_mode == StartMode::prewarmed) {
+            threadpool_detail::Latch ready(min_threads_);
+            start_workers(&ready);
+            ready.wait();
+        } else {
+            start_workers(nullptr);
+        }
+        emit(PoolEventType::started, min_threads_, max_threads_);
+    }
+
+    template<class F, class... Args>
+    auto submit(F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type> {
+
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        // Promise 与调用参数一起直接构造在 Task 的内联缓冲区里，
+        // 共享状态取自线程本地回收链表，典型的小闭包不再触发堆分配
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        Task task(make_promise_task(std::move(promise),
+            threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...)));
+
+        enqueue(std::move(task));
+        return result;
+    }
+
+    // 按优先级提交：high 的任务优先出队，各级按 8:4:2:1 加权轮转，低优先级不会被饿死
+    template<class F, class... Args>
+    auto submit_with_priority(TaskPriority level, F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type> {
+
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        enqueue(Task(make_promise_task(std::move(promise),
+            threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...))), level);
+        return result;
+    }
+
+    // 提交到指定 NUMA 节点的队列，由绑定在该节点上的线程优先执行；
+    // 该节点没有空闲线程时，其他节点的线程在自己无事可做时才会取走它。node 超出范围时按节点数取模
+    template<class F, class... Args>
+    auto submit_on_node(size_t node, F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type> {
+
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        enqueue(Task(make_promise_task(std::move(promise),
+            threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...))),
+            TaskPriority::normal, AdmitMode::policy, std::chrono::steady_clock::time_point(),
+            static_cast<int>(node % node_queues_.size()));
+        return result;
+    }
+
+    // 拓扑中的 NUMA 节点数（读取失败或非 NUMA 机器为 1）
+    size_t numa_node_count() const {
+        return node_queues_.size();
+    }
+
+    // 某一优先级的队列深度与排队时间统计（无锁读取）
+    PriorityLevelStats priority_stats(TaskPriority level) const {
+        return injection_queue_.stats(static_cast<size_t>(level));
+    }
+
+    // 队列已满时不等待、不执行拒绝策略，直接返回无效的 Future（valid() == false）
+    template<class F, class... Args>
+    auto try_submit(F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type> {
+
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        if (!enqueue(Task(make_promise_task(std::move(promise),
+                threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...))),
+                TaskPriority::normal, AdmitMode::try_once)) {
+            return Future<return_type>();
+        }
+        return result;
+    }
+
+    // 队列已满时最多等待 timeout，超时返回无效的 Future
+    template<class Rep, class Period, class F, class... Args>
+    auto submit_for(const std::chrono::duration<Rep, Period>& timeout, F&& f, Args&&... args)
+        -> Future<typename std::result_of<F(Args...)>::type> {
+
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        if (!enqueue(Task(make_promise_task(std::move(promise),
+                threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...))),
+                TaskPriority::normal, AdmitMode::until_deadline, deadline)) {
+            return Future<return_type>();
+        }
+        return result;
+    }
+
+    // 只执行、不关心结果的提交方式：队列里只保存可调用对象，不创建 Promise/Future。
+    // 任务抛出的异常交给 set_exception_handler 设置的处理函数
+    template<class F, class... Args>
+    void post(F&& f, Args&&... args) {
+        enqueue(Task(threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...)));
+    }
+
+    // 取得名为 name 的资源组，不存在时按默认配置（权重 1、不限并发）创建。
+    // 查找要加锁，频繁提交时保存返回的引用：auto& ingest = pool.group("ingest"); ingest.submit(...)
+    ResourceGroup& group(const std::string& name) {
+        size_t released = 0;
+        return groups_.get(this, name, nullptr, released).handle;
+    }
+
+    // 创建资源组或修改已有组的权重与并发上限，新配置从下一次出队起生效
+    ResourceGroup& group(const std::string& name, const ResourceGroupOptions& options) {
+        size_t released = 0;
+        ResourceGroup& result = groups_.get(this, name, &options, released).handle;
+        wake_workers(released);
+        return result;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    // co_await pool.schedule() 把当前协程挂起并转到工作线程上继续，定义见 ThreadPoolCoro.hpp（需 C++20）
+    coro::ScheduleAwaitable schedule();
+#endif
+
+    // 设置全线程池共享的未处理异常回调；默认把异常信息写到 std::cerr
+    void set_exception_handler(std::function<void(std::exception_ptr)> handler) {
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        exception_handler_ = std::move(handler);
+    }
+
+    // 设置扩缩容回调，在控制器线程上调用，不持有线程池的锁
+    void set_scale_callback(std::function<void(const ScaleEvent&)> callback) {
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        scale_callback_ = std::move(callback);
+    }
+
+    // 批量提交：对 [0, n) 的每个下标执行 fn(i)。整批在一次加锁内入队，只唤醒需要的空闲线程，
+    // 返回一个代表整批完成的 Future，任一任务抛出的第一个异常由它传出
+    template<class F>
+    Future<void> submit_n(size_t n, F&& fn) {
+        typedef threadpool_detail::IndexBody<typename std::decay<F>::type> Body;
+        Body body = { std::forward<F>(fn) };
+        return submit_indexed(n, std::move(body));
+    }
+
+    // 同上，结果写入调用方提供的输出区间：out[i] = fn(i)
+    template<class F, class OutIt>
+    Future<void> submit_n(size_t n, F&& fn, OutIt out) {
+        typedef threadpool_detail::IndexOutBody<typename std::decay<F>::type, OutIt> Body;
+        Body body = { std::forward<F>(fn), out };
+        return submit_indexed(n, std::move(body));
+    }
+
+    // 对 [first, last) 的每个元素执行 fn(*it)
+    template<class It, class F>
+    Future<void> submit_bulk(It first, It last, F&& fn) {
+        typedef threadpool_detail::ElementBody<typename std::decay<F>::type> Body;
+        Body body = { std::forward<F>(fn) };
+        return submit_range(first, last, std::move(body));
+    }
+
+    // 同上，结果按元素顺序写入输出区间：out[k] = fn(*(first + k))
+    template<class It, class F, class OutIt>
+    Future<void> submit_bulk(It first, It last, F&& fn, OutIt out) {
+        typedef threadpool_detail::ElementOutBody<typename std::decay<F>::type, OutIt> Body;
+        Body body = { std::forward<F>(fn), out };
+        return submit_range(first, last, std::move(body));
+    }
+
+    // 并行循环：对 [begin, end) 的每个下标执行 body(i)。调用线程也参与计算，
+    // 迭代按 guided 方式惰性切块，min_chunk 为 0 时自动选择最小块大小
+    template<class Index, class Body>
+    void parallel_for(Index begin, Index end, Body&& body, size_t min_chunk = 0) {
+        typedef typename std::remove_reference<Body>::type BodyType;
+        typedef threadpool_detail::ForChunk<Index, BodyType> Chunk;
+        if (!(begin < end)) {
+            return;
+        }
+        size_t total = static_cast<size_t>(end - begin);
+        Chunk chunk = { begin, &body };
+        run_loop(total, loop_participants(total, min_chunk), min_chunk, chunk);
+    }
+
+    // 并行归约：result = combine(..., map(i), ...)。每个参与者在独占缓存行的槽里累加，
+    // 最后由调用线程合并；combine 需满足结合律与交换律，identity 为其单位元
+    template<class Index, class T, class Map, class Combine>
+    T parallel_reduce(Index begin, Index end, T identity, Map&& map, Combine&& combine, size_t min_chunk = 0) {
+        typedef typename std::remove_reference<Map>::type MapType;
+        typedef typename std::remove_reference<Combine>::type CombineType;
+        typedef threadpool_detail::ReduceChunk<Index, T, MapType, CombineType> Chunk;
+        if (!(begin < end)) {
+            return identity;
+        }
+        size_t total = static_cast<size_t>(end - begin);
+        size_t participants = loop_participants(total, min_chunk);
+        std::vector<threadpool_detail::PaddedValue<T>> slots(participants, threadpool_detail::PaddedValue<T>(identity));
+        Chunk chunk = { begin, &map, &combine, &slots };
+        run_loop(total, participants, min_chunk, chunk);
+
+        T result = std::move(slots[0].value);
+        for (size_t i = 1; i < slots.size(); ++i) {
+            result = combine(std::move(result), std::move(slots[i].value));
+        }
+        return result;
+    }
+
+    size_t get_thread_count() const {
+        return thread_count_.load();
+    }
+
+    // 线程池与各工作线程的计数快照，只读原子变量，不影响提交与执行
+    PoolStats stats() const {
+        PoolStats result = PoolStats();
+        result.threads = thread_count_.load();
+        result.idle_threads = idle_count_.load();
+        result.queued_tasks = pending_.load();
+        result.rejected_tasks = rejected_count_.load();
+        result.discarded_tasks = discarded_count_.load();
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            const WorkerSlot& slot = *slots_[i];
+            WorkerStats w;
+            w.slot = i;
+            w.active = slot.in_use.load();
+            w.status = slot.status.load(std::memory_order_relaxed);
+            w.local_queue_size = slot.size.load(std::memory_order_relaxed);
+            w.tasks_executed = slot.tasks_executed.load(std::memory_order_relaxed);
+            w.busy_ns = slot.busy_ns.load(std::memory_order_relaxed);
+            w.idle_ns = slot.idle_ns.load(std::memory_order_relaxed);
+            w.steals = slot.steals.load(std::memory_order_relaxed);
+            w.wakeups = slot.wakeups.load(std::memory_order_relaxed);
+            w.spurious_wakeups = slot.spurious_wakeups.load(std::memory_order_relaxed);
+            if (!w.active && w.tasks_executed == 0 && w.idle_ns == 0) {
+                continue; // 从未使用过的槽位
+            }
+            result.tasks_executed += w.tasks_executed;
+            result.busy_ns += w.busy_ns;
+            result.idle_ns += w.idle_ns;
+            result.steals += w.steals;
+            result.wakeups += w.wakeups;
+            result.spurious_wakeups += w.spurious_wakeups;
+            result.workers.push_back(w);
+        }
+        return result;
+    }
+
+    // 合并各工作线程的排队/执行时间直方图；未开启 latency_histograms 时为空。
+    // 只统计经队列执行的任务（caller_runs 在提交线程上执行的任务不计入）
+    LatencyStats latency() const {
+        LatencyStats result;
+        if (latency_histograms_) {
+            for (const std::unique_ptr<WorkerSlot>& slot : slots_) {
+                slot->queue_wait->merge_into(result.queue_wait);
+                slot->execution->merge_into(result.execution);
+            }
+        }
+        return result;
+    }
+
+    // 在任务内部调用，为当前任务在追踪中命名；name 必须在导出前一直有效（通常是字符串字面量）。
+    // 不在工作线程上或未开启追踪时无效果
+    static void trace_label(const char* name) {
+        current_worker().trace_name = name;
+    }
+
+    // 当前工作线程的任务内存池，在任务内部使用；任务结束时自动回退，分配的内存不能带出任务。
+    // 不在工作线程上或 worker_arena_bytes 为 0 时返回 nullptr（ArenaAllocator 此时退回全局堆）
+    static WorkerArena* local_arena() {
+        WorkerSlot* slot = current_worker().slot;
+        return slot ? slot->arena.get() : nullptr;
+    }
+
+    // 导出 Chrome Trace Event JSON（可用 Perfetto 或 chrome://tracing 打开）：
+    // 每个工作线程一条轨道，包含任务执行区间（附排队时间）和挂起区间；控制器轨道记录扩缩容。
+    // 可在运行中调用，只读取已写完的记录
+    void write_trace(std::ostream& out) const {
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        auto begin_event = [&out, &first]() {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+        // 纳秒输出为带三位小数的微秒
+        auto write_us = [&out](int64_t ns) {
+            ns = std::max<int64_t>(0, ns);
+            out << ns / 1000 << '.' << static_cast<char>('0' + ns / 100 % 10)
+                << static_cast<char>('0' + ns / 10 % 10) << static_cast<char>('0' + ns % 10);
+        };
+        auto write_thread_name = [&](size_t tid, const std::string& name) {
+            begin_event();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+        };
+
+        if (controller_trace_) {
+            write_thread_name(0, "controller");
+            for (size_t i = 0, n = controller_trace_->size(); i < n; ++i) {
+                const threadpool_detail::TraceRecord& r = (*controller_trace_)[i];
+                begin_event();
+                out << "{\"ph\":\"i\",\"s\":\"g\",\"cat\":\"scale\",\"name\":\""
+                    << (r.to > r.from ? "scale_up" : "scale_down") << "\",\"pid\":1,\"tid\":0,\"ts\":";
+                write_us(r.begin_ns - trace_epoch_ns_);
+                out << ",\"args\":{\"from\":" << r.from << ",\"to\":" << r.to << "}}";
+                begin_event();
+                out << "{\"ph\":\"C\",\"name\":\"threads\",\"pid\":1,\"tid\":0,\"ts\":";
+                write_us(r.begin_ns - trace_epoch_ns_);
+                out << ",\"args\":{\"threads\":" << r.to << "}}";
+            }
+        }
+        for (size_t index = 0; index < slots_.size(); ++index) {
+            const threadpool_detail::TraceBuffer* trace = slots_[index]->trace.get();
+            size_t n = trace ? trace->size() : 0;
+            if (n == 0) {
+                continue;
+            }
+            write_thread_name(index + 1, "worker " + std::to_string(index));
+            for (size_t i = 0; i < n; ++i) {
+                const threadpool_detail::TraceRecord& r = (*trace)[i];
+                bool is_task = r.kind == threadpool_detail::TraceKind::task;
+                begin_event();
+                out << "{\"ph\":\"X\",\"cat\":\"" << (is_task ? "task" : "idle") << "\",\"name\":\"";
+                if (!is_task) {
+                    out << "parked";
+                } else if (r.name) {
+                    write_json_string(out, r.name);
+                } else {
+                    out << "task";
+                }
+                out << "\",\"pid\":1,\"tid\":" << index + 1 << ",\"ts\":";
+                write_us(r.begin_ns - trace_epoch_ns_);
+                out << ",\"dur\":";
+                write_us(r.end_ns - r.begin_ns);
+                if (is_task) {
+                    out << ",\"args\":{\"queued_us\":";
+                    write_us(r.begin_ns - r.queued_ns);
+                    out << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    // 追踪缓冲写满后丢弃的记录数
+    uint64_t get_dropped_trace_count() const {
+        uint64_t dropped = controller_trace_ ? controller_trace_->dropped() : 0;
+        for (const std::unique_ptr<WorkerSlot>& slot : slots_) {
+            if (slot->trace) {
+                dropped += slot->trace->dropped();
+            }
+        }
+        return dropped;
+    }
+
+    // 在岗工作线程的状态快照
+    std::vector<WorkerInfo> get_worker_info() const {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        std::vector<WorkerInfo> result;
+        result.reserve(workers_.size());
+        for (const WorkerSlot* slot : workers_) {
+            WorkerInfo info = { slot->thread.get_id(), slot->status.load(std::memory_order_relaxed),
+                                slot->tasks_executed.load(std::memory_order_relaxed),
+                                slot->size.load(std::memory_order_relaxed), slot->cpu, slot->node };
+            result.push_back(info);
+        }
+        return result;
+    }
+
+    // 全局注入队列与各线程本地队列中尚未被取走的任务总数
+    size_t get_queue_size() const {
+        return pending_.load();
+    }
+
+    // 因队列已满被拒绝（抛出或 try/超时失败）的任务数
+    size_t get_rejected_count() const {
+        return rejected_count_.load();
+    }
+
+    // 被 discard_oldest 策略丢弃的排队任务数
+    size_t get_discarded_count() const {
+        return discarded_count_.load();
+    }
+
+    // 事件队列已满而丢弃的事件数
+    size_t get_dropped_event_count() const {
+        return dropped_events_.load();
+    }
+
+    // 安全的空闲线程计数（无锁版本）
+    size_t get_idle_count_safe() const {
+        return idle_count_.load();
+    }
+
+
+    ~ThreadPool() {
+        // 先停控制器，之后 workers_ 只由析构函数访问
+        {
+            std::lock_guard<std::mutex> lock(controller_mutex_);
+            controller_stop_ = true;
+        }
+        controller_cv_.notify_one();
+        if (controller_.joinable()) {
+            controller_.join();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            shutdown_ = true;
+        }
+        wake_workers(max_threads_);
+        {
+            // 唤醒阻塞在有界队列上的提交方，让它们抛出而不是永远等待
+            std::lock_guard<std::mutex> lock(space_mutex_);
+            space_cv_.notify_all();
+        }
+
+        for (WorkerSlot* slot : workers_) {
+            if (slot->thread.joinable()) {
+                slot->thread.join();
+            }
+        }
+        for (WorkerSlot* slot : retiring_) {
+            slot->thread.join();
+        }
+        emit(PoolEventType::shutdown, 0, 0);
+        drain_events();
+    }
+
+private:
+    friend class TaskGraph;   // 就绪节点绕过有界队列的容量检查直接入队
+    friend class TaskGroup;   // 同上；等待时借用工作线程执行其他任务
+    friend class TimerService; // 到期任务整批入队，同样不受容量限制
+    friend class ResourceGroup; // 组任务进入组队列，由组间调度出队
+#if defined(__cpp_impl_coroutine)
+    friend class coro::ScheduleAwaitable; // 协程的恢复任务必须入队，不能被拒绝或在挂起点内联执行
+#endif
+
+    static ThreadPoolOptions make_options(size_t min_threads, size_t max_threads,
+                                          std::chrono::milliseconds min_stable_time) {
+        ThreadPoolOptions options;
+        options.min_threads = min_threads;
+        options.max_threads = max_threads;
+        options.min_stable_time = min_stable_time;
+        return options;
+    }
+
+    // 每线程队列与节点队列：节点块经 TaskBlockCache 在线程内回收，弹空后再压入不必重新分配
+    typedef std::deque<Task, threadpool_detail::BlockAllocator<Task>> TaskDeque;
+
+    // 每个工作线程的控制块，按缓存行对齐：
+    // 第一部分会被其他线程访问（窃取本地队列、唤醒、设置退出标志），
+    // 第二部分只由拥有者频繁写入，单独占缓存行，避免与窃取者互相失效
+    struct alignas(threadpool_detail::kCacheLine) WorkerSlot {
+        SpinLock lock;
+        TaskDeque tasks;                    // 拥有者在尾部压入/弹出，空闲线程从头部窃取
+        std::atomic<size_t> size{0};        // 无锁读取的队列长度，窃取前先检查
+        threadpool_detail::Parker parker;   // 空闲时在此挂起，提交方从空闲栈里挑中后单独唤醒
+        std::atomic<bool> exit{false};      // 控制器要求该线程退休
+        std::thread thread;                 // 持有 queue_mutex_ 时读写
+        std::atomic<bool> in_use{false};    // 线程退出且被 join 之后才能复用；持有 queue_mutex_ 时写入
+        int cpu = -1;                       // 构造时按绑核策略确定，槽位复用时不变
+        size_t node = 0;
+
+        // 拥有者写、stats() 无锁读的状态与计数
+        alignas(threadpool_detail::kCacheLine) std::atomic<ThreadStatus> status{ThreadStatus::stopped};
+        std::atomic<uint64_t> tasks_executed{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> idle_ns{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> wakeups{0};
+        std::atomic<uint64_t> spurious_wakeups{0};
+        size_t polls = 0;                   // 取任务次数，只由拥有者访问
+        // 刚从资源组取出、尚未执行的任务所属的组及预记的执行时间，由 try_get_task 写入、execute 取走；只由拥有者访问
+        threadpool_detail::GroupQueue* group = nullptr;
+        int64_t group_charge = 0;
+        bool group_turn = false;            // 资源组与共享队列轮流优先
+        // 开启 latency_histograms 时构造，之后只由拥有者写入
+        std::unique_ptr<threadpool_detail::HistogramRecorder> queue_wait;
+        std::unique_ptr<threadpool_detail::HistogramRecorder> execution;
+        std::unique_ptr<threadpool_detail::TraceBuffer> trace;   // 开启追踪时构造，只由拥有者写入
+        std::unique_ptr<WorkerArena> arena;                      // 只由拥有者使用，每个任务结束后回退
+
+        static void* operator new(size_t size) {
+            return threadpool_detail::aligned_allocate(size, threadpool_detail::kCacheLine);
+        }
+        static void operator delete(void* p) {
+            threadpool_detail::aligned_deallocate(p);
+        }
+    };
+
+    // 每个 NUMA 节点一个提交队列（FIFO），本节点的线程优先取，其他节点的线程在本节点无事可做时才来取
+    struct alignas(threadpool_detail::kCacheLine) NodeQueue {
+        SpinLock lock;
+        TaskDeque tasks;
+        std::atomic<size_t> size{0};
+
+        static void* operator new(size_t size) {
+            return threadpool_detail::aligned_allocate(size, threadpool_detail::kCacheLine);
+        }
+        static void operator delete(void* p) {
+            threadpool_detail::aligned_deallocate(p);
+        }
+    };
+
+    std::atomic<bool> shutdown_{false};
+    std::vector<WorkerSlot*> workers_;                   // 在岗线程的控制块，按创建顺序
+    std::vector<WorkerSlot*> retiring_;                  // 已要求退休、尚未 join 的控制块，只由控制器访问
+    threadpool_detail::PriorityTaskQueue injection_queue_; // 外部提交者使用的全局注入队列（按优先级分级）
+    std::atomic<size_t> injection_size_{0};
+    std::unique_ptr<MpmcQueue<Task>> submit_ring_;       // SubmitQueue::lock_free 时的无锁提交队列
+    std::vector<std::unique_ptr<WorkerSlot>> slots_;     // 大小固定为 max_threads_
+    std::vector<std::unique_ptr<NodeQueue>> node_queues_; // 每个 NUMA 节点一个，至少一个
+    threadpool_detail::GroupScheduler groups_;           // 资源组队列与组间调度
+    std::atomic<size_t> pending_{0};                     // 所有队列中待执行的任务数
+    mutable std::mutex queue_mutex_;
+    SpinLock idle_lock_;
+    std::vector<size_t> idle_stack_;                     // 已登记挂起的工作线程槽位，后进先出（缓存最热的先醒）
+    std::atomic<size_t> idle_count_{0};                  // 与 idle_stack_ 大小一致，供提交方无锁判断
+    size_t min_threads_;
+    size_t max_threads_;
+    std::chrono::steady_clock::time_point last_scale_time_; // 最后一次扩缩容时间
+    std::chrono::milliseconds min_stable_time_;            // 最短稳定时间（冷却期）
+    size_t queue_capacity_;                              // 排队任务上限，0 表示不限
+    RejectionPolicy rejection_policy_;
+    size_t idle_spins_;
+    size_t idle_yields_;
+    std::mutex space_mutex_;                             // 阻塞的提交方在 space_cv_ 上等待空位
+    std::condition_variable space_cv_;
+    std::atomic<size_t> blocked_producers_{0};
+    std::atomic<size_t> rejected_count_{0};
+    std::atomic<size_t> discarded_count_{0};
+    std::mutex handler_mutex_;
+    std::function<void(std::exception_ptr)> exception_handler_; // post 任务的未处理异常回调
+    std::function<void(const ScaleEvent&)> scale_callback_;
+    std::chrono::milliseconds scale_interval_;
+    size_t scale_up_backlog_;
+    std::chrono::microseconds scale_up_wait_;
+    double scale_down_utilization_;
+    std::thread controller_;                             // 自动扩缩容控制器
+    std::mutex controller_mutex_;
+    std::condition_variable controller_cv_;
+    bool controller_stop_ = false;
+    std::atomic<bool> lazy_start_{false};                // StartMode::lazy 且尚未启动
+    std::atomic<size_t> thread_count_{0};                // workers_.size() 的无锁副本
+    const bool latency_histograms_;
+    const size_t trace_capacity_;
+    const bool stamp_tasks_;                              // 入队时是否记录时间戳
+    const int64_t trace_epoch_ns_;                       // 追踪时间轴的零点
+    std::unique_ptr<threadpool_detail::TraceBuffer> controller_trace_; // 只由控制器线程写入
+    const bool numa_local_submit_;
+#ifndef THREADPOOL_DISABLE_EVENTS
+    std::shared_ptr<PoolEventSink> event_sink_;
+    std::unique_ptr<MpmcQueue<PoolEvent>> events_;       // 待投递的事件，产生事件的线程只做一次无锁入队
+    size_t reported_rejected_ = 0;                       // 已通过事件报告的拒绝数/丢弃数，只由投递方访问
+    size_t reported_discarded_ = 0;
+#endif
+    std::atomic<size_t> dropped_events_{0};
+
+    template<class R, class Fn>
+    static threadpool_detail::PromiseTask<R, Fn> make_promise_task(Promise<R>&& promise, Fn&& fn) {
+        return threadpool_detail::PromiseTask<R, Fn>(std::move(promise), std::move(fn));
+    }
+
+    // 单次从全局队列搬运到本地队列的最大任务数
+    static const size_t kInjectionBatch = 32;
+    // 事件环形队列容量，控制器每个采样周期清空一次
+    static const size_t kEventCapacity = 1024;
+
+    // 使用无锁提交队列时，每隔多少次取任务先查一次分级队列
+    static const size_t kRingFairness = 4;
+
+    struct WorkerContext {
+        ThreadPool* pool;
+        WorkerSlot* slot;
+        const char* trace_name;   // 当前任务的追踪标签
+        size_t index;             // 槽位下标
+    };
+
+    static WorkerContext& current_worker() {
+        static thread_local WorkerContext ctx = {nullptr, nullptr, nullptr, 0};
+        return ctx;
+    }
+
+    // 当前线程若是本线程池的工作线程，返回其本地队列
+    WorkerSlot* local_slot() {
+        WorkerContext& ctx = current_worker();
+        return ctx.pool == this ? ctx.slot : nullptr;
+    }
+
+    // 记录事件：不做 I/O、不加锁，队列满时只计数
+    void emit(PoolEventType type, size_t threads, size_t count) {
+#ifndef THREADPOOL_DISABLE_EVENTS
+        if (!events_) {
+            return;
+        }
+        PoolEvent event = { type, threadpool_detail::now_ns(), threads, count };
+        if (!events_->try_push(std::move(event))) {
+            dropped_events_++;
+        }
+#else
+        (void)type;
+        (void)threads;
+        (void)count;
+#endif
+    }
+
+    // 只由控制器线程和析构函数调用，on_event 不会并发执行
+    void drain_events() {
+#ifndef THREADPOOL_DISABLE_EVENTS
+        if (!events_) {
+            return;
+        }
+        PoolEvent event;
+        while (events_->try_pop(event)) {
+            event_sink_->on_event(event);
+        }
+        report_counter(PoolEventType::tasks_rejected, rejected_count_.load(), reported_rejected_);
+        report_counter(PoolEventType::tasks_discarded, discarded_count_.load(), reported_discarded_);
+#endif
+    }
+
+    void report_counter(PoolEventType type, size_t total, size_t& reported) {
+#ifndef THREADPOOL_DISABLE_EVENTS
+        if (total != reported) {
+            PoolEvent event = { type, threadpool_detail::now_ns(), 0, total - reported };
+            reported = total;
+            event_sink_->on_event(event);
+        }
+#else
+        (void)type;
+        (void)total;
+        (void)reported;
+#endif
+    }
+
+    bool needs_controller() const {
+#ifndef THREADPOOL_DISABLE_EVENTS
+        if (events_) {
+            return true;
+        }
+#endif
+        return max_threads_ > min_threads_;
+    }
+
+    // 启动 min_threads_ 个工作线程和后台控制器（负责扩缩容与投递事件）；
+    // ready 非空时每个线程就绪后倒数一次
+    void start_workers(threadpool_detail::Latch* ready) {
+        spawn_workers(min_threads_, ready);
+        if (needs_controller()) {
+            controller_ = std::thread([this]() { controller_loop(); });
+        }
+    }
+
+    // StartMode::lazy：第一个提交者负责启动，其余提交者不等待，任务先留在队列里
+    void start_lazily() {
+        if (lazy_start_.exchange(false)) {
+            start_workers(nullptr);
+        }
+    }
+
+    // 在锁内只预留控制块并计入 workers_；创建线程是耗时的系统调用，放到锁外进行，
+    // 创建完再加锁把线程对象交给控制块。返回实际创建的线程数
+    size_t spawn_workers(size_t n, threadpool_detail::Latch* ready) {
+        std::vector<size_t> indices;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (shutdown_) {
+                return 0;
+            }
+            size_t index = 0;
+            while (indices.size() < n) {
+                while (index < slots_.size() && slots_[index]->in_use) {
+                    ++index;
+                }
+                if (index == slots_.size()) {
+                    break; // 没有空闲控制块（退休线程还未被回收）
+                }
+                WorkerSlot& slot = *slots_[index];
+                slot.in_use = true;
+                slot.exit.store(false);
+                slot.status.store(ThreadStatus::idle);
+                workers_.push_back(&slot);
+                thread_count_.store(workers_.size());
+                indices.push_back(index);
+            }
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(indices.size());
+        for (size_t index : indices) {
+            threads.emplace_back([this, index, ready]() { worker_loop(index, ready); });
+        }
+
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            slots_[indices[i]]->thread = std::move(threads[i]);
+        }
+        return indices.size();
+    }
+
+    // 参与者 = 调用线程 + 工作线程，但不超过可切出的块数
+    size_t loop_participants(size_t total, size_t min_chunk) const {
+        size_t chunk = min_chunk ? min_chunk : 1;
+        size_t chunks = (total + chunk - 1) / chunk;
+        return std::max<size_t>(1, std::min(get_thread_count() + 1, chunks));
+    }
+
+    // 默认最小块：让块总数约为参与者数的 256 倍，兼顾负载均衡与调度开销
+    static size_t default_min_chunk(size_t total, size_t participants) {
+        return std::max<size_t>(1, total / (participants * 256));
+    }
+
+    template<class Chunk>
+    void run_loop(size_t total, size_t participants, size_t min_chunk, Chunk chunk) {
+        typedef threadpool_detail::LoopState<Chunk> State;
+        typedef threadpool_detail::LoopHelper<State> Helper;
+        if (min_chunk == 0) {
+            min_chunk = default_min_chunk(total, participants);
+        }
+        std::shared_ptr<State> state = std::make_shared<State>(total, participants, min_chunk, chunk);
+
+        if (participants > 1) {
+            enqueue_batch(participants - 1, [&state](size_t) { return Task(Helper{state}); }, AdmitMode::force);
+        }
+        state->participate(state->join());
+        state->wait();
+    }
+
+    template<class Body>
+    Future<void> submit_indexed(size_t n, Body&& body) {
+        typedef threadpool_detail::BulkState<Body> State;
+        typedef threadpool_detail::BulkTask<State, size_t> BulkTask;
+        if (n == 0) {
+            return ready_future();
+        }
+        State* state = new State(std::move(body), n);
+        Future<void> result = state->promise.get_future();
+        try {
+            enqueue_batch(n, [state](size_t i) { return Task(BulkTask(state, i, i)); });
+        } catch (...) {
+            delete state; // 入队失败时还没有任务引用该状态
+            throw;
+        }
+        return result;
+    }
+
+    template<class It, class Body>
+    Future<void> submit_range(It first, It last, Body&& body) {
+        typedef threadpool_detail::BulkState<Body> State;
+        typedef threadpool_detail::BulkTask<State, It> BulkTask;
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if (n == 0) {
+            return ready_future();
+        }
+        State* state = new State(std::move(body), n);
+        Future<void> result = state->promise.get_future();
+        It it = first;
+        try {
+            enqueue_batch(n, [state, &it](size_t i) { return Task(BulkTask(state, it++, i)); });
+        } catch (...) {
+            delete state;
+            throw;
+        }
+        return result;
+    }
+
+    static Future<void> ready_future() {
+        Promise<void> promise;
+        promise.set_value();
+        return promise.get_future();
+    }
+
+    // 单个任务入队：工作线程内部提交进入本地队列，外部提交进入全局注入队列
+    // 入队时如何处理队列已满：policy 走配置的拒绝策略，try_once 立即放弃，
+    // until_deadline 等到截止时间，force 不受容量限制（池内部的辅助任务使用）
+    // grouped：按拒绝策略处理，但 discard_oldest 不把任务换进全局队列（资源组任务只能进入组队列）
+    enum class AdmitMode { policy, try_once, until_deadline, force, grouped };
+
+    enum class Admission { reserved, rejected, handled };
+
+    // 返回 false 表示任务因队列已满被拒绝（仅 try_once / until_deadline）
+    // node >= 0 时进入该 NUMA 节点的提交队列（只用于普通优先级）
+    bool enqueue(Task&& task, TaskPriority priority = TaskPriority::normal,
+                 AdmitMode mode = AdmitMode::policy,
+                 std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point(),
+                 int node = -1) {
+        if(shutdown_) {
+            throw std::runtime_error("submit called on stopped ThreadPool");
+        }
+        if (lazy_start_.load(std::memory_order_relaxed)) {
+            start_lazily();
+        }
+
+        bool reserved = false;
+        if (queue_capacity_ != 0 && mode != AdmitMode::force) {
+            auto make = [&task](size_t) { return std::move(task); };
+            Admission admission = admit(1, priority, mode, deadline, make);
+            if (admission != Admission::reserved) {
+                return admission == Admission::handled;
+            }
+            reserved = true;
+        }
+        if (stamp_tasks_) {
+            task.set_enqueued_ns(threadpool_detail::now_ns());
+        }
+
+        // 工作线程内部提交的普通优先级任务直接进入自己的本地队列，不碰全局锁；
+        // 其他优先级必须进入全局分级队列，才能与外部任务按优先级竞争
+        WorkerSlot* local = priority == TaskPriority::normal ? local_slot() : nullptr;
+        if (local && (node < 0 || static_cast<size_t>(node) == local->node)) {
+            if (!reserved) {
+                pending_++;
+            }
+            {
+                std::lock_guard<SpinLock> guard(local->lock);
+                local->tasks.emplace_back(std::move(task));
+                local->size.store(local->tasks.size(), std::memory_order_relaxed);
+            }
+            wake_one();
+            return true;
+        }
+
+        // 外部线程开启 numa_local_submit 时按自己当前所在的节点投递
+        if (priority == TaskPriority::normal && node < 0 && !local && numa_local_submit_ && node_queues_.size() > 1) {
+            node = static_cast<int>(threadpool_detail::cpu_topology().node_of(threadpool_detail::current_cpu()));
+        }
+        if (priority == TaskPriority::normal && node >= 0) {
+            if (!reserved) {
+                pending_++;
+            }
+            NodeQueue& queue = *node_queues_[static_cast<size_t>(node) % node_queues_.size()];
+            {
+                std::lock_guard<SpinLock> guard(queue.lock);
+                queue.tasks.emplace_back(std::move(task));
+                queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+            }
+            wake_one(static_cast<size_t>(node) % node_queues_.size());
+            return true;
+        }
+
+        // 外部线程的普通优先级任务优先进入无锁环形队列；环满时继续走下面的互斥队列
+        if (priority == TaskPriority::normal && submit_ring_) {
+            if (!reserved) {
+                pending_++;
+                reserved = true;
+            }
+            if (submit_ring_->try_push(std::move(task))) {
+                wake_one();
+                return true;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+
+            if(shutdown_) {
+                if (reserved) {
+                    task_dequeued(1);
+                }
+                throw std::runtime_error("submit called on stopped ThreadPool");
+            }
+
+            if (!reserved) {
+                pending_++;
+            }
+            injection_queue_.push(std::move(task), static_cast<size_t>(priority), threadpool_detail::now_ns());
+            injection_size_.store(injection_queue_.size(), std::memory_order_relaxed);
+        }
+
+        wake_one();
+        return true;
+    }
+
+    // 按顺序调用 make(0..n-1) 生成任务，整批在一次加锁内入队，然后按需唤醒；
+    // 线程池已停止时在生成任何任务之前抛出
+    template<class MakeTask>
+    void enqueue_batch(size_t n, MakeTask make, AdmitMode mode = AdmitMode::policy) {
+        if(shutdown_) {
+            throw std::runtime_error("submit called on stopped ThreadPool");
+        }
+        if (lazy_start_.load(std::memory_order_relaxed)) {
+            start_lazily();
+        }
+
+        bool reserved = false;
+        if (queue_capacity_ != 0 && mode != AdmitMode::force) {
+            if (admit(n, TaskPriority::normal, mode, std::chrono::steady_clock::time_point(), make) != Admission::reserved) {
+                return;
+            }
+            reserved = true;
+        }
+        int64_t stamp = stamp_tasks_ ? threadpool_detail::now_ns() : 0;
+
+        WorkerSlot* local = local_slot();
+        if (local) {
+            if (!reserved) {
+                pending_ += n;
+            }
+            {
+                std::lock_guard<SpinLock> guard(local->lock);
+                for (size_t i = 0; i < n; ++i) {
+                    local->tasks.emplace_back(make(i));
+                    local->tasks.back().set_enqueued_ns(stamp);
+                }
+                local->size.store(local->tasks.size(), std::memory_order_relaxed);
+            }
+            wake_workers(n);
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+
+            if(shutdown_) {
+                if (reserved) {
+                    task_dequeued(n);
+                }
+                throw std::runtime_error("submit called on stopped ThreadPool");
+            }
+
+            if (!reserved) {
+                pending_ += n;
+            }
+            int64_t now = threadpool_detail::now_ns();
+            size_t level = static_cast<size_t>(TaskPriority::normal);
+            for (size_t i = 0; i < n; ++i) {
+                Task task = make(i);
+                task.set_enqueued_ns(stamp);
+                injection_queue_.push(std::move(task), level, now);
+            }
+            injection_size_.store(injection_queue_.size(), std::memory_order_relaxed);
+        }
+        wake_workers(n);
+    }
+
+    // 资源组任务进入所在组的队列，只由 try_get_task 经组间调度取出；计入 pending_ 与有界队列容量
+    void enqueue_group(threadpool_detail::GroupQueue& group, Task&& task) {
+        if(shutdown_) {
+            throw std::runtime_error("submit called on stopped ThreadPool");
+        }
+        if (lazy_start_.load(std::memory_order_relaxed)) {
+            start_lazily();
+        }
+
+        bool reserved = false;
+        if (queue_capacity_ != 0) {
+            auto make = [&task](size_t) { return std::move(task); };
+            if (admit(1, TaskPriority::normal, AdmitMode::grouped, std::chrono::steady_clock::time_point(), make) !=
+                Admission::reserved) {
+                return;
+            }
+            reserved = true;
+        }
+        if (stamp_tasks_) {
+            task.set_enqueued_ns(threadpool_detail::now_ns());
+        }
+        if (!reserved) {
+            pending_++;
+        }
+        // 所在组已达并发上限时不必唤醒：组内任务结束时会唤醒
+        if (groups_.push(group, std::move(task))) {
+            wake_one();
+        }
+    }
+
+    // 为 n 个任务在有界队列中占位（成功时 pending_ 已加 n）。
+    // 队列为空时总是放行，超过容量的单个批次不会永远阻塞
+    bool try_reserve(size_t n) {
+        size_t current = pending_.load();
+        do {
+            if (current != 0 && current + n > queue_capacity_) {
+                return false;
+            }
+        } while (!pending_.compare_exchange_weak(current, current + n));
+        return true;
+    }
+
+    // 队列已满时的处理。reserved：已占位，调用方继续入队；
+    // handled：任务已由拒绝策略处理（在当前线程执行或替换了旧任务）；rejected：未入队
+    template<class MakeTask>
+    Admission admit(size_t n, TaskPriority priority, AdmitMode mode,
+                    std::chrono::steady_clock::time_point deadline, MakeTask& make) {
+        if (try_reserve(n)) {
+            return Admission::reserved;
+        }
+        if (mode == AdmitMode::try_once) {
+            reject(n);
+            return Admission::rejected;
+        }
+        if (mode == AdmitMode::until_deadline) {
+            if (wait_for_space(n, &deadline)) {
+                return Admission::reserved;
+            }
+            reject(n);
+            return Admission::rejected;
         }
-        std::cout << "ThreadPool initialized with " << min_threads_ << " threads, max: " << max_threads_ << std::endl;
-        
-        // 等待所有工作线程真正启动
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        switch (rejection_policy_) {
+        case RejectionPolicy::throw_exception:
+            reject(n);
+            throw TaskRejectedError("ThreadPool queue is full");
+        case RejectionPolicy::caller_runs:
+            run_inline(n, make);
+            return Admission::handled;
+        case RejectionPolicy::discard_oldest:
+            if (mode != AdmitMode::grouped && replace_oldest(n, priority, make)) {
+                return Admission::handled;
+            }
+            break; // 全局队列里没有可丢弃的任务（都在工作线程本地队列中），退化为阻塞
+        case RejectionPolicy::block:
+            break;
+        }
+
+        // 工作线程阻塞等待自己所在池的空位可能让所有线程互相等待，改为在当前线程执行
+        if (local_slot()) {
+            run_inline(n, make);
+            return Admission::handled;
+        }
+        wait_for_space(n, nullptr);
+        return Admission::reserved;
     }
 
-    template<class F, class... Args>
-    auto submit(F&& f, Args&&... args) 
-        -> std::future<typename std::result_of<F(Args...)>::type> {
-        
-        using return_type = typename std::result_of<F(Args...)>::type;
-        
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        
-        std::future<return_type> result = task->get_future();
+    // 拒绝/丢弃可能在过载时高频发生，提交方只累加计数，由 drain_events 按周期合并成一个事件
+    void reject(size_t n) {
+        rejected_count_ += n;
+    }
+
+    template<class MakeTask>
+    void run_inline(size_t n, MakeTask& make) {
+        for (size_t i = 0; i < n; ++i) {
+            Task task = make(i);
+            run_task(task);
+        }
+    }
+
+    // 在阻塞的提交方中等待空位；deadline 为空表示一直等。
+    // 返回 true 表示已占位；线程池停止时抛出
+    bool wait_for_space(size_t n, const std::chrono::steady_clock::time_point* deadline) {
+        bool reserved = false;
+        auto ready = [this, n, &reserved]() {
+            if (shutdown_) {
+                return true;
+            }
+            reserved = try_reserve(n);
+            return reserved;
+        };
+
+        {
+            std::unique_lock<std::mutex> lock(space_mutex_);
+            blocked_producers_++;
+            if (deadline) {
+                space_cv_.wait_until(lock, *deadline, ready);
+            } else {
+                space_cv_.wait(lock, ready);
+            }
+            blocked_producers_--;
+        }
+
+        if (!reserved && shutdown_) {
+            throw std::runtime_error("submit called on stopped ThreadPool");
+        }
+        return reserved;
+    }
 
+    // discard_oldest：在锁内丢弃最低优先级中最老的 n 个排队任务，换入新任务。
+    // 被丢弃的任务在锁外析构，其 Future 以 broken_promise 结束
+    template<class MakeTask>
+    bool replace_oldest(size_t n, TaskPriority priority, MakeTask& make) {
+        std::vector<Task> discarded;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            
-            if(shutdown_) {
+            if (shutdown_) {
                 throw std::runtime_error("submit called on stopped ThreadPool");
             }
+            if (injection_queue_.size() < n) {
+                return false;
+            }
+            discarded.resize(n);
+            int64_t now = threadpool_detail::now_ns();
+            for (size_t i = 0; i < n; ++i) {
+                injection_queue_.pop_oldest_lowest(discarded[i]);
+                injection_queue_.push(make(i), static_cast<size_t>(priority), now);
+            }
+            injection_size_.store(injection_queue_.size(), std::memory_order_relaxed);
+        }
+        discarded_count_ += n;
+        wake_one();
+        return true;
+    }
+
+    // 任务离开队列（被取走执行或入队失败退回占位），有界模式下唤醒等待空位的提交方
+    void task_dequeued(size_t n) {
+        pending_ -= n;
+        if (blocked_producers_.load() != 0) {
+            std::lock_guard<std::mutex> lock(space_mutex_);
+            space_cv_.notify_all();
+        }
+    }
+
+    // 最多唤醒 n 个空闲线程，一次通知过程
+    void wake_workers(size_t n) {
+        if (idle_count_.load() == 0) {
+            return;
+        }
+        size_t woken[64];
+        while (n > 0) {
+            size_t count = 0;
+            {
+                std::lock_guard<SpinLock> guard(idle_lock_);
+                while (count < n && count < 64 && !idle_stack_.empty()) {
+                    woken[count++] = idle_stack_.back();
+                    idle_stack_.pop_back();
+                }
+                idle_count_ -= count;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                slots_[woken[i]]->parker.unpark();
+            }
+            if (count < 64) {
+                return;
+            }
+            n -= count;
+        }
+    }
 
-            tasks_.emplace([task](){ (*task)(); });
+    // 提交方先增加 pending_ 再读 idle_count_，与工作线程“先登记空闲再复查 pending_”配对，
+    // 不会漏唤醒；没有空闲线程时不碰任何锁。唤醒的是空闲栈顶的那个线程，而不是任意等待者
+    void wake_one() {
+        if (idle_count_.load() == 0) {
+            return;
+        }
+        size_t index;
+        {
+            std::lock_guard<SpinLock> guard(idle_lock_);
+            if (idle_stack_.empty()) {
+                return;
+            }
+            index = idle_stack_.back();
+            idle_stack_.pop_back();
+            idle_count_--;
+        }
+        slots_[index]->parker.unpark();
+    }
 
-            // 更保守的扩容策略
-            if (tasks_.size() > 2 && get_idle_count_safe() == 0 && workers_.size() < max_threads_) {
-                workers_.emplace_back([this]() { 
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                    worker_loop(); 
-                });
-                std::cout << "Dynamic expansion: Thread created. Total: " << workers_.size() << std::endl;
+    // 优先唤醒属于 node 的空闲线程（仍按后进先出），该节点没有空闲线程时唤醒任意一个
+    void wake_one(size_t node) {
+        if (idle_count_.load() == 0) {
+            return;
+        }
+        size_t index;
+        {
+            std::lock_guard<SpinLock> guard(idle_lock_);
+            if (idle_stack_.empty()) {
+                return;
+            }
+            auto it = idle_stack_.end() - 1;
+            for (auto candidate = idle_stack_.rbegin(); candidate != idle_stack_.rend(); ++candidate) {
+                if (slots_[*candidate]->node == node) {
+                    it = candidate.base() - 1;
+                    break;
+                }
             }
+            index = *it;
+            idle_stack_.erase(it);
+            idle_count_--;
         }
+        slots_[index]->parker.unpark();
+    }
 
-        condition_.notify_one();
-        return result;
+    // 空闲第一阶段：自旋 + 让出 CPU，期间只读 pending_，有任务或需要退出时返回 true
+    bool spin_for_work(const WorkerSlot& slot) {
+        for (size_t i = 0; i < idle_spins_; ++i) {
+            if (has_work_or_signal(slot)) {
+                return true;
+            }
+            threadpool_detail::cpu_relax();
+        }
+        for (size_t i = 0; i < idle_yields_; ++i) {
+            std::this_thread::yield();
+            if (has_work_or_signal(slot)) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    size_t get_thread_count() const {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        return workers_.size();
+    bool has_work_or_signal(const WorkerSlot& slot) const {
+        return runnable_pending() > 0 || shutdown_ || slot.exit.load();
     }
 
-    size_t get_queue_size() const {
+    // 可以立即执行的排队任务数：扣除受资源组并发上限阻挡的任务，否则空闲线程会为它们空转
+    size_t runnable_pending() const {
+        size_t held = groups_.held();
+        size_t pending = pending_.load();
+        return pending > held ? pending - held : 0;
+    }
+
+    // 空闲第二阶段：登记到空闲栈后复查一次，确实无事可做才停车；返回是否真的挂起过
+    bool park_idle(size_t index) {
+        WorkerSlot& slot = *slots_[index];
+        {
+            std::lock_guard<SpinLock> guard(idle_lock_);
+            idle_stack_.push_back(index);
+            idle_count_++;
+        }
+        bool parked = !has_work_or_signal(slot);
+        if (parked) {
+            int64_t begin = slot.trace ? threadpool_detail::now_ns() : 0;
+            slot.status.store(ThreadStatus::parked, std::memory_order_relaxed);
+            slot.parker.park();
+            slot.status.store(ThreadStatus::idle, std::memory_order_relaxed);
+            threadpool_detail::add_relaxed(slot.wakeups, 1);
+            if (slot.trace) {
+                threadpool_detail::TraceRecord record = {
+                    threadpool_detail::TraceKind::parked, nullptr, begin, threadpool_detail::now_ns(), 0, 0, 0 };
+                slot.trace->push(record);
+            }
+        }
+        leave_idle(index);
+        return parked;
+    }
+
+    // 复查发现有任务或遇到残留许可时仍在栈里，自己出栈；已被提交方弹出则什么也不做
+    void leave_idle(size_t index) {
+        std::lock_guard<SpinLock> guard(idle_lock_);
+        auto it = std::find(idle_stack_.begin(), idle_stack_.end(), index);
+        if (it != idle_stack_.end()) {
+            idle_stack_.erase(it);
+            idle_count_--;
+        }
+    }
+
+    bool pop_local(WorkerSlot& slot, Task& task) {
+        if (slot.size.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        std::lock_guard<SpinLock> guard(slot.lock);
+        if (slot.tasks.empty()) {
+            return false;
+        }
+        task = std::move(slot.tasks.back());
+        slot.tasks.pop_back();
+        slot.size.store(slot.tasks.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    // 从全局队列取一个任务执行，并顺带搬运一批同级任务到本地队列供其他线程窃取。
+    // 高优先级任务不搬运，保证它们始终在全局队列里优先被取走
+    bool pop_injection(WorkerSlot& slot, Task& task) {
+        if (injection_size_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
         std::unique_lock<std::mutex> lock(queue_mutex_);
-        return tasks_.size();
+        int64_t now = threadpool_detail::now_ns();
+        size_t level = 0;
+        if (!injection_queue_.pop(task, now, level)) {
+            return false;
+        }
+
+        size_t workers = std::max<size_t>(workers_.size(), 1);
+        size_t batch = level == static_cast<size_t>(TaskPriority::high) ? 0 :
+            std::min(static_cast<size_t>(kInjectionBatch), injection_queue_.level_size(level) / workers);
+        if (batch > 0) {
+            std::lock_guard<SpinLock> guard(slot.lock);
+            Task moved;
+            for (size_t i = 0; i < batch && injection_queue_.pop_level(level, moved, now); ++i) {
+                slot.tasks.push_front(std::move(moved));
+            }
+            slot.size.store(slot.tasks.size(), std::memory_order_relaxed);
+        }
+        injection_size_.store(injection_queue_.size(), std::memory_order_relaxed);
+        return true;
     }
 
-    // 安全的空闲线程计数（无锁版本）
-    size_t get_idle_count_safe() const {
-        return idle_count_.load();
+    // 从其他线程的队列头部窃取，起点随线程错开以分散竞争。
+    // same_node > 0 只偷本节点的线程，< 0 只偷其他节点的线程，0 不区分
+    bool steal(size_t self, Task& task, int same_node) {
+        size_t n = slots_.size();
+        size_t node = slots_[self]->node;
+        for (size_t k = 1; k < n; ++k) {
+            WorkerSlot& victim = *slots_[(self + k) % n];
+            if (victim.size.load(std::memory_order_relaxed) == 0 ||
+                (same_node != 0 && (victim.node == node) != (same_node > 0))) {
+                continue;
+            }
+            std::lock_guard<SpinLock> guard(victim.lock);
+            if (victim.tasks.empty()) {
+                continue;
+            }
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            victim.size.store(victim.tasks.size(), std::memory_order_relaxed);
+            return true;
+        }
+        return false;
     }
 
+    bool try_get_task(size_t index, Task& task) {
+        WorkerSlot& slot = *slots_[index];
+        // 有高优先级任务排队时先看全局队列，不让它们等在本地任务后面
+        if (injection_queue_.depth(static_cast<size_t>(TaskPriority::high)) > 0 && pop_injection(slot, task)) {
+            task_dequeued(1);
+            return true;
+        }
+        // 环形队列里只有普通优先级任务；每 kRingFairness 次先看一次分级队列，其他级别不会被它饿死
+        bool injection_first = submit_ring_ && ++slot.polls % kRingFairness == 0;
+        // 本地队列之后，资源组与未分组的共享队列轮流优先，两边都有积压时各得约一半的取任务机会
+        bool groups_first = groups_.has_runnable() && (slot.group_turn = !slot.group_turn);
+        if (pop_local(slot, task) ||
+            (groups_first && pop_group(slot, task)) ||
+            (injection_first && pop_injection(slot, task)) ||
+            pop_node(slot.node, task) ||
+            pop_ring(task) ||
+            (!injection_first && pop_injection(slot, task)) ||
+            (!groups_first && pop_group(slot, task))) {
+            task_dequeued(1);
+            return true;
+        }
+        // 先在本节点内窃取；跨节点取任务只是兜底
+        bool numa = node_queues_.size() > 1;
+        if (steal(index, task, numa ? 1 : 0)) {
+            threadpool_detail::add_relaxed(slot.steals, 1);
+            task_dequeued(1);
+            return true;
+        }
+        if (numa) {
+            for (size_t k = 1; k < node_queues_.size(); ++k) {
+                if (pop_node((slot.node + k) % node_queues_.size(), task)) {
+                    task_dequeued(1);
+                    return true;
+                }
+            }
+            if (steal(index, task, -1)) {
+                threadpool_detail::add_relaxed(slot.steals, 1);
+                task_dequeued(1);
+                return true;
+            }
+        }
+        return false;
+    }
 
-    ~ThreadPool() {
+    bool pop_node(size_t node, Task& task) {
+        NodeQueue& queue = *node_queues_[node];
+        if (queue.size.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        std::lock_guard<SpinLock> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop_ring(Task& task) {
+        return submit_ring_ && submit_ring_->try_pop(task);
+    }
+
+    bool pop_group(WorkerSlot& slot, Task& task) {
+        return groups_.has_runnable() && groups_.pop(task, slot.group, slot.group_charge);
+    }
+
+    // 退休线程把本地剩余任务交还给全局队列
+    void drain_local_locked(WorkerSlot& slot) {
+        std::lock_guard<SpinLock> guard(slot.lock);
+        int64_t now = threadpool_detail::now_ns();
+        while (!slot.tasks.empty()) {
+            injection_queue_.push(std::move(slot.tasks.front()), static_cast<size_t>(TaskPriority::normal), now);
+            slot.tasks.pop_front();
+        }
+        slot.size.store(0, std::memory_order_relaxed);
+        injection_size_.store(injection_queue_.size(), std::memory_order_relaxed);
+    }
+
+    // 按 JSON 字符串规则转义（不含两侧引号）
+    static void write_json_string(std::ostream& out, const char* text) {
+        static const char kHex[] = "0123456789abcdef";
+        for (const char* p = text; *p; ++p) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"' || c == '\\') {
+                out << '\\' << *p;
+            } else if (c < 0x20) {
+                out << "\\u00" << kHex[c >> 4] << kHex[c & 15];
+            } else {
+                out << *p;
+            }
+        }
+    }
+
+    // 任务抛出的异常（只可能来自 post 提交的任务）不能让工作线程退出
+    void run_task(Task& task) {
+        try {
+            task();
+        } catch (...) {
+            handle_exception(std::current_exception());
+        }
+    }
+
+    // 在工作线程上执行一个任务并记账；等待中代为执行时会嵌套在另一个任务里，
+    // 因此保存外层的追踪标签，内存池也只回退到本任务开始时的位置。资源组任务结束后按实际耗时给所属组记账
+    void execute(WorkerSlot& slot, Task& task) {
+        threadpool_detail::GroupQueue* group = slot.group;
+        int64_t charge = slot.group_charge;
+        slot.group = nullptr;
+        WorkerArena::Marker mark = { nullptr, nullptr };
+        if (slot.arena) {
+            mark = slot.arena->mark();
+        }
+        if (stamp_tasks_) {
+            const char* outer = current_worker().trace_name;
+            current_worker().trace_name = nullptr;
+            int64_t start = threadpool_detail::now_ns();
+            run_task(task);
+            int64_t end = threadpool_detail::now_ns();
+            if (group) {
+                groups_.finish(*group, charge, end - start);
+            }
+            if (slot.queue_wait) {
+                slot.queue_wait->record(static_cast<uint64_t>(std::max<int64_t>(0, start - task.enqueued_ns())));
+                slot.execution->record(static_cast<uint64_t>(end - start));
+            }
+            if (slot.trace) {
+                threadpool_detail::TraceRecord record = {
+                    threadpool_detail::TraceKind::task, current_worker().trace_name,
+                    start, end, task.enqueued_ns(), 0, 0 };
+                slot.trace->push(record);
+            }
+            current_worker().trace_name = outer;
+        } else if (group) {
+            int64_t start = threadpool_detail::now_ns();
+            run_task(task);
+            groups_.finish(*group, charge, threadpool_detail::now_ns() - start);
+        } else {
+            run_task(task);
+        }
+        if (slot.arena) {
+            slot.arena->rewind(mark);
+        }
+        threadpool_detail::add_relaxed(slot.tasks_executed, 1);
+    }
+
+    // 当前线程是本线程池的工作线程时，按正常的取任务顺序取一个任务就地执行；
+    // 不是工作线程或没有可执行的任务时返回 false
+    bool help_one() {
+        WorkerContext& ctx = current_worker();
+        if (ctx.pool != this) {
+            return false;
+        }
+        Task task;
+        if (!try_get_task(ctx.index, task)) {
+            return false;
+        }
+        execute(*ctx.slot, task);
+        return true;
+    }
+
+    void handle_exception(std::exception_ptr error) {
+        std::function<void(std::exception_ptr)> handler;
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            shutdown_ = true;
+            std::lock_guard<std::mutex> lock(handler_mutex_);
+            handler = exception_handler_;
         }
-        condition_.notify_all();
-        
-        for (auto &worker : workers_) {
-            if (worker.joinable()) {
-                worker.join();
+        if (handler) {
+            try {
+                handler(error);
+            } catch (...) {
+                // 处理函数自身抛出的异常只能忽略
             }
+            return;
+        }
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            std::cerr << "ThreadPool: unhandled exception in posted task: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "ThreadPool: unhandled non-standard exception in posted task" << std::endl;
         }
-        std::cout << "ThreadPool destroyed successfully." << std::endl;
     }
 
-private:
-    std::atomic<bool> shutdown_{false};
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    mutable std::mutex queue_mutex_;
-    std::condition_variable condition_;
-    std::atomic<size_t> idle_count_{0};
-    size_t min_threads_;
-    size_t max_threads_;
-    std::chrono::steady_clock::time_point last_scale_time_; // 最后一次扩缩容时间
-    std::chrono::milliseconds min_stable_time_;            // 最短稳定时间（冷却期）
-    std::vector<std::thread::id> threads_to_retire_;     // 待退休线程ID列表
+void worker_loop(size_t index, threadpool_detail::Latch* ready) {
+    WorkerSlot& slot = *slots_[index];
+    current_worker().pool = this;
+    current_worker().slot = &slot;
+    current_worker().index = index;
+    if (slot.cpu >= 0) {
+        threadpool_detail::pin_current_thread(slot.cpu);
+    }
+    if (ready) {
+        ready->count_down();
+    }
+
+    // 只在忙/闲切换时读时钟：连续执行的任务合并为一段忙碌时间
+    auto phase_start = std::chrono::steady_clock::now();
+    bool busy = false;
+    bool woke = false;  // 上一轮刚从挂起中被唤醒
+    auto end_phase = [&](std::atomic<uint64_t>& counter) {
+        auto now = std::chrono::steady_clock::now();
+        threadpool_detail::add_relaxed(counter, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count()));
+        phase_start = now;
+    };
 
-void worker_loop() {
-    auto my_id = std::this_thread::get_id();
     while (true) {
-        std::function<void()> task;
-        bool should_exit = false;
+        Task task;
 
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            idle_count_++;
+        if (try_get_task(index, task)) {
+            if (!busy) {
+                end_phase(slot.idle_ns);
+                busy = true;
+            }
+            woke = false;
+            // 执行任务（不持有任何锁）
+            slot.status.store(ThreadStatus::busy, std::memory_order_relaxed);
+            execute(slot, task);
+            slot.status.store(ThreadStatus::idle, std::memory_order_relaxed);
+            continue;
+        }
+        if (busy) {
+            end_phase(slot.busy_ns);
+            busy = false;
+        }
 
-            condition_.wait(lock, [this, my_id]() {
-                return shutdown_ || !tasks_.empty() || should_retire(my_id);
-            });
-
-            
-            if (shutdown_ && tasks_.empty()) {
-                idle_count_--;
-                should_exit = true;
-            } else if (should_retire(my_id)) {
-                threads_to_retire_.erase(std::remove(threads_to_retire_.begin(), threads_to_retire_.end(), my_id), threads_to_retire_.end());
-                idle_count_--;
-                should_exit = true;
-                std::cout << "Thread " << my_id << " is retiring as requested.\n";
-            } else if (!tasks_.empty()) {
-                task = std::move(tasks_.front());
-                tasks_.pop();
-                idle_count_--;
-            }
-            // 如果是虚假唤醒，则继续循环
-        } // 锁作用域结束
-
-        if (should_exit) {
+        if (slot.exit.load()) {
+            retire(slot);
+            break;
+        }
+        if (shutdown_ && pending_ == 0) {
             break;
         }
+        if (woke) {
+            threadpool_detail::add_relaxed(slot.spurious_wakeups, 1);
+            woke = false;
+        }
+        if (!spin_for_work(slot)) {
+            woke = park_idle(index);
+        }
+    }
+    end_phase(busy ? slot.busy_ns : slot.idle_ns);
+    current_worker().pool = nullptr;
+    current_worker().slot = nullptr;
+    // 控制器看到 stopped 后才 join 并回收控制块，此时 join 不会阻塞
+    slot.status.store(ThreadStatus::stopped);
+}
 
-        if (task) {
-            // 执行任务
-            task();
+
+struct AutoscaleState {
+    uint64_t wait_ns = 0;           // 上次采样时全局队列的累计排队时间
+    uint64_t dequeued = 0;          // 上次采样时全局队列的累计出队数
+    double utilization = 0;         // 指数平滑后的利用率
+    std::chrono::steady_clock::time_point low_since; // 利用率持续偏低的起点
+};
+
+// 控制器线程：每个 scale_interval_ 采样一次并做扩缩容决策，然后投递积压的事件
+void controller_loop() {
+    AutoscaleState state;
+    state.low_since = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(controller_mutex_);
+    while (!controller_stop_) {
+        controller_cv_.wait_for(lock, scale_interval_);
+        if (controller_stop_) {
+            break;
+        }
+        lock.unlock();
+        if (max_threads_ > min_threads_) {
+            autoscale_tick(state);
+        }
+        drain_events();
+        lock.lock();
+    }
+}
+
+// 扩容看排队压力（有积压且没有空闲线程），缩容看持续的低利用率；
+// 两个条件之间留有空档，且缩容受 min_stable_time_ 冷却期约束，避免来回振荡
+void autoscale_tick(AutoscaleState& state) {
+    reap_retired();
+
+    auto now = std::chrono::steady_clock::now();
+    size_t threads = 0;
+    size_t busy_threads = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        threads = workers_.size();
+        for (WorkerSlot* slot : workers_) {
+            if (slot->status.load(std::memory_order_relaxed) == ThreadStatus::busy) {
+                ++busy_threads;
+            }
         }
     }
-    // 线程自然结束
+    size_t idle = std::min(idle_count_.load(), threads);
+    size_t depth = runnable_pending();
+
+    uint64_t wait_ns = 0;
+    uint64_t dequeued = 0;
+    for (size_t level = 0; level < threadpool_detail::PriorityTaskQueue::kLevels; ++level) {
+        PriorityLevelStats stats = injection_queue_.stats(level);
+        wait_ns += stats.total_wait_ns;
+        dequeued += stats.dequeued;
+    }
+    double avg_wait_us = dequeued > state.dequeued ?
+        static_cast<double>(wait_ns - state.wait_ns) / (dequeued - state.dequeued) / 1000.0 : 0.0;
+    state.wait_ns = wait_ns;
+    state.dequeued = dequeued;
+
+    double busy = threads ? static_cast<double>(busy_threads) / threads : 0.0;
+    state.utilization = 0.7 * state.utilization + 0.3 * busy;
+
+    size_t target = threads;
+    bool pressure = idle == 0 && depth > 0 &&
+        (depth > threads * scale_up_backlog_ ||
+         avg_wait_us > static_cast<double>(scale_up_wait_.count()));
+    if (pressure) {
+        // 按积压量一次扩到位，至少加一个线程
+        size_t wanted = std::max(threads + 1, (depth + scale_up_backlog_ - 1) / scale_up_backlog_);
+        target = std::min(max_threads_, wanted);
+    }
+    if (pressure || depth > 0 || state.utilization >= scale_down_utilization_) {
+        state.low_since = now;
+    } else if (threads > min_threads_ && now - state.low_since >= min_stable_time_) {
+        // 每次最多减半，给负载回升留余地
+        target = std::max(min_threads_, threads / 2);
+    }
+
+    if (target > threads) {
+        scale_up(target);
+    } else if (target < threads) {
+        target = check_and_scale_down_simple(target);
+        state.low_since = now;
+    }
+    if (target == threads) {
+        return;
+    }
+    if (controller_trace_) {
+        int64_t at = threadpool_detail::now_ns();
+        threadpool_detail::TraceRecord record = {
+            threadpool_detail::TraceKind::scale, nullptr, at, at, 0, threads, target };
+        controller_trace_->push(record);
+    }
+
+    std::function<void(const ScaleEvent&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        callback = scale_callback_;
+    }
+    if (callback) {
+        ScaleEvent event = { threads, target, depth, avg_wait_us, state.utilization };
+        callback(event);
+    }
 }
-    
 
-void check_and_scale_down_simple() {
-    std::thread::id target_id;
-    bool need_notify = false;
+void scale_up(size_t target) {
+    size_t current = get_thread_count();
+    if (target <= current) {
+        return;
+    }
+    size_t spawned = spawn_workers(target - current, nullptr);
+    size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        last_scale_time_ = std::chrono::steady_clock::now();
+        total = workers_.size();
+    }
+    emit(PoolEventType::threads_spawned, total, spawned);
+}
 
+// 让最近创建的若干线程退休，只由控制器线程调用：设置其退出标志并单独唤醒，
+// 不等待它们结束；join 推迟到 reap_retired()，届时线程已退出
+size_t check_and_scale_down_simple(size_t target) {
+    size_t first = 0;
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
         auto now = std::chrono::steady_clock::now();
 
-        if (workers_.size() > min_threads_ &&
-            tasks_.empty() &&
-            idle_count_ >= workers_.size() - 1 &&
-            (now - last_scale_time_) >= min_stable_time_) {
+        if (shutdown_ || workers_.size() <= min_threads_ || pending_ != 0 ||
+            (now - last_scale_time_) < min_stable_time_) {
+            return workers_.size();
+        }
+        target = std::max(target, min_threads_);
+        first = retiring_.size();
+        while (workers_.size() > target) {
+            WorkerSlot* slot = workers_.back();
+            workers_.pop_back();
+            thread_count_.store(workers_.size());
+            slot->exit.store(true);
+            retiring_.push_back(slot);
+        }
+        last_scale_time_ = now;
+    } // 锁在这里释放
+    emit(PoolEventType::threads_retired, target, retiring_.size() - first);
 
-            auto it = std::find_if(workers_.begin(), workers_.end(),
-                [this](const std::thread& t) {
-                    return t.get_id() != std::this_thread::get_id();
-                });
+    // 停车许可会被保留，即使线程还没挂起也不会错过
+    for (size_t i = first; i < retiring_.size(); ++i) {
+        retiring_[i]->parker.unpark();
+    }
+    return target;
+}
 
-            if (it != workers_.end()) {
-                target_id = it->get_id();
-                threads_to_retire_.push_back(target_id);
-                workers_.erase(it);
-                last_scale_time_ = now;
-                need_notify = true;
-                std::cout << "Marked thread " << target_id << " for retirement.\n";
-            }
+// 回收已经退出的退休线程，每次采样时调用
+void reap_retired() {
+    for (size_t i = 0; i < retiring_.size();) {
+        WorkerSlot* slot = retiring_[i];
+        if (slot->status.load() != ThreadStatus::stopped) {
+            ++i;
+            continue;
         }
-    } // 锁在这里释放
+        slot->thread.join();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            slot->in_use = false;
+        }
+        retiring_[i] = retiring_.back();
+        retiring_.pop_back();
+    }
+}
 
-    if (need_notify) {
-        condition_.notify_all(); // 安全地在锁外通知
+    // 退休线程把本地任务交还全局队列后退出
+    void retire(WorkerSlot& slot) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            drain_local_locked(slot);
+        }
+        wake_one();
     }
+};
+
+// ==========================================
+// 资源组的提交入口（需要完整的 ThreadPool 定义）
+// ==========================================
+
+template<class F, class... Args>
+auto ResourceGroup::submit(F&& f, Args&&... args)
+    -> Future<typename std::result_of<F(Args...)>::type> {
+
+    using return_type = typename std::result_of<F(Args...)>::type;
+
+    Promise<return_type> promise;
+    Future<return_type> result = promise.get_future();
+    pool_->enqueue_group(*queue_, Task(ThreadPool::make_promise_task(std::move(promise),
+        threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...))));
+    return result;
 }
 
-    bool should_retire(std::thread::id id){
-        auto it = std::find(threads_to_retire_.begin(), threads_to_retire_.end(), id);
-        if(it != threads_to_retire_.end()){
-            return true;
+template<class F, class... Args>
+void ResourceGroup::post(F&& f, Args&&... args) {
+    pool_->enqueue_group(*queue_, Task(threadpool_detail::bind_call(std::forward<F>(f), std::forward<Args>(args)...)));
+}
+
+inline ResourceGroupStats ResourceGroup::stats() const {
+    return pool_->groups_.stats(*queue_);
+}
+
+// ==========================================
+// 非阻塞延续：then / when_all / when_any
+// ==========================================
+// 三者都挂在共享状态唯一的完成回调槽上，由设置结果的线程触发，没有线程为此等待
+
+namespace threadpool_detail {
+
+struct FutureAccess {
+    template<class T>
+    static SharedState<T>* state(const Future<T>& future) {
+        if (!future.state_) {
+            throw std::future_error(std::future_errc::no_state);
         }
-        return false;
+        return future.state_;
+    }
+
+    template<class T>
+    static Future<T> adopt(SharedState<T>* state) {
+        return Future<T>(state);
+    }
+};
+
+// 延续本体：在工作线程上以就绪的前驱 Future 调用 f
+template<class T, class Fn>
+struct ContinuationCall {
+    Future<T> input;
+    Fn fn;
+
+    typename std::result_of<Fn(Future<T>)>::type operator()() {
+        return fn(std::move(input));
+    }
+};
+
+// 前驱就绪时在完成方线程上运行，只负责把延续投递到线程池。
+// 线程池已停止时投递失败，延续随 Task 析构，它的 Promise 以 broken_promise 结束
+template<class Work>
+struct ScheduleContinuation {
+    ThreadPool* pool;
+    Work work;
+
+    void operator()() {
+        try {
+            pool->post(std::move(work));
+        } catch (...) {
+        }
+    }
+};
+
+// when_all 的汇合点：初始计数多 1，由注册方在注册完所有回调后释放，避免注册途中就被删除
+template<class Result, class Futures>
+struct WhenAllState {
+    Futures futures;
+    std::atomic<size_t> remaining;
+    Promise<Result> promise;
+
+    WhenAllState(Futures&& f, size_t n) : futures(std::move(f)), remaining(n + 1) {}
+
+    void arrive() {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        Promise<Result> done = std::move(promise);
+        Result result = std::move(futures);
+        delete this;
+        done.set_value(std::move(result));
+    }
+
+    struct Arrive {
+        WhenAllState* state;
+        void operator()() { state->arrive(); }
+    };
+
+    template<class T>
+    void watch(Future<T>& future) {
+        FutureAccess::state(future)->on_ready(Task(Arrive{this}));
+    }
+};
+
+template<class Tuple, size_t... I>
+void check_all(const Tuple& futures, IndexSeq<I...>) {
+    int expand[] = { 0, (FutureAccess::state(std::get<I>(futures)), 0)... };
+    (void)expand;
+}
+
+template<class State, class Tuple, size_t... I>
+void watch_all(State* state, Tuple& futures, IndexSeq<I...>) {
+    int expand[] = { 0, (state->watch(std::get<I>(futures)), 0)... };
+    (void)expand;
+}
+
+} // namespace threadpool_detail
+
+template<class T>
+template<class F>
+auto Future<T>::then(ThreadPool& pool, F&& f)
+    -> Future<typename std::result_of<typename std::decay<F>::type(Future<T>)>::type> {
+    typedef typename std::decay<F>::type Fn;
+    typedef typename std::result_of<Fn(Future<T>)>::type R;
+    typedef threadpool_detail::PromiseTask<R, threadpool_detail::ContinuationCall<T, Fn>> Work;
+
+    State* state = threadpool_detail::FutureAccess::state(*this);
+    state_ = nullptr;
+    Promise<R> promise;
+    Future<R> result = promise.get_future();
+    threadpool_detail::ContinuationCall<T, Fn> call = { Future<T>(state), std::forward<F>(f) };
+    threadpool_detail::ScheduleContinuation<Work> schedule = { &pool, Work(std::move(promise), std::move(call)) };
+    state->on_ready(Task(std::move(schedule)));
+    return result;
+}
+
+// 所有输入都就绪后就绪，结果按原顺序交还这些（已就绪的）Future；输入中的异常留在各自的 Future 里
+template<class T>
+Future<std::vector<Future<T>>> when_all(std::vector<Future<T>> futures) {
+    typedef std::vector<Future<T>> Result;
+    typedef threadpool_detail::WhenAllState<Result, Result> State;
+    for (const Future<T>& f : futures) {
+        threadpool_detail::FutureAccess::state(f);
+    }
+    size_t n = futures.size();
+    State* state = new State(std::move(futures), n);
+    Future<Result> result = state->promise.get_future();
+    for (size_t i = 0; i < n; ++i) {
+        state->watch(state->futures[i]);
+    }
+    state->arrive();
+    return result;
+}
+
+template<class... T>
+Future<std::tuple<Future<T>...>> when_all(Future<T>&&... futures) {
+    typedef std::tuple<Future<T>...> Result;
+    typedef threadpool_detail::WhenAllState<Result, Result> State;
+    typedef typename threadpool_detail::MakeIndexSeq<sizeof...(T)>::type Indices;
+    Result inputs(std::move(futures)...);
+    threadpool_detail::check_all(inputs, Indices());
+    State* state = new State(std::move(inputs), sizeof...(T));
+    Future<Result> result = state->promise.get_future();
+    threadpool_detail::watch_all(state, state->futures, Indices());
+    state->arrive();
+    return result;
+}
+
+// when_any 的结果：最先就绪的输入下标和它的 Future（已就绪）
+template<class T>
+struct WhenAnyResult {
+    size_t index;
+    Future<T> future;
+};
+
+namespace threadpool_detail {
+
+// 每个输入的回调各持有一份引用；第一个到达的取走自己的 Future 兑现结果，最后一个到达的删除状态
+template<class T>
+struct WhenAnyState {
+    std::vector<Future<T>> futures;
+    std::atomic<size_t> refs;
+    std::atomic<bool> decided;
+    Promise<WhenAnyResult<T>> promise;
+
+    WhenAnyState(std::vector<Future<T>>&& f) : futures(std::move(f)), refs(futures.size() + 1), decided(false) {}
+
+    void arrive(size_t index) {
+        if (!decided.exchange(true, std::memory_order_acq_rel)) {
+            WhenAnyResult<T> result = { index, std::move(futures[index]) };
+            promise.set_value(std::move(result));
+        }
+        release();
+    }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    struct Arrive {
+        WhenAnyState* state;
+        size_t index;
+        void operator()() { state->arrive(index); }
+    };
+};
+
+} // namespace threadpool_detail
+
+// 任一输入就绪即就绪；其余输入的结果被丢弃。输入为空时抛出 std::invalid_argument
+template<class T>
+Future<WhenAnyResult<T>> when_any(std::vector<Future<T>> futures) {
+    typedef threadpool_detail::WhenAnyState<T> State;
+    if (futures.empty()) {
+        throw std::invalid_argument("when_any requires at least one future");
+    }
+    for (const Future<T>& f : futures) {
+        threadpool_detail::FutureAccess::state(f);
     }
-};
\ No newline at end of file
+    size_t n = futures.size();
+    State* state = new State(std::move(futures));
+    Future<WhenAnyResult<T>> result = state->promise.get_future();
+    for (size_t i = 0; i < n; ++i) {
+        threadpool_detail::FutureAccess::state(state->futures[i])->on_ready(
+            Task(typename State::Arrive{state, i}));
+    }
+    state->release();
+    return result;
+}
@@ -0,0 +1,263 @@
+// ThreadPoolCoro.hpp
+#pragma once
+
+// 协程接口需要 C++20（g++ -std=c++20）；ThreadPool.hpp 本身仍是 C++11
+#include "ThreadPool.hpp"
+
+#if !defined(__cpp_impl_coroutine)
+#error "ThreadPoolCoro.hpp requires C++20 coroutines (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// 线程池的 C++20 协程接口：
+//   co_await pool.schedule()   挂起当前协程，转到工作线程上继续
+//   co_await future            等待 Future 就绪，不占用任何线程
+//   coro::Task<T>              惰性协程，被 co_await 时才开始执行，结束时对称转移回等待方
+//   coro::spawn / sync_wait    从普通代码启动协程
+// 挂起中的协程只是一块协程帧：恢复它的 Task 只装一个 coroutine_handle，存放在 Task 的内联缓冲区里，
+// 由工作线程直接从运行队列中取出并 resume，入队与恢复都不额外分配内存
+namespace coro {
+
+namespace detail {
+
+// 运行队列 / 完成回调里的恢复动作
+struct Resume {
+    std::coroutine_handle<> handle;
+    void operator()() { handle.resume(); }
+};
+
+} // namespace detail
+
+// 挂起后把恢复动作投递到线程池。恢复任务不受容量限制（与 TaskGraph 的就绪节点相同）：
+// 拒绝策略会让它被丢弃（协程永远挂起）或在 await_suspend 内联恢复，所以不走拒绝策略；
+// 线程池已停止时 co_await 抛出 std::runtime_error，协程留在原线程上
+class ScheduleAwaitable {
+public:
+    explicit ScheduleAwaitable(ThreadPool& pool) noexcept : pool_(&pool) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        pool_->enqueue(::Task(detail::Resume{handle}), TaskPriority::normal, ThreadPool::AdmitMode::force);
+    }
+    void await_resume() const noexcept {}
+
+private:
+    ThreadPool* pool_;
+};
+
+template<class T = void> class Task;
+
+namespace detail {
+
+// 协程结束时恢复等待方（对称转移，不增加调用栈深度）；没有等待方就停在最终挂起点，由 Task 销毁协程帧
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template<class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+};
+
+template<class T>
+struct TaskPromise : PromiseBase {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+
+    Task<T> get_return_object() noexcept;
+
+    template<class U>
+    void return_value(U&& value) { result.template emplace<1>(std::forward<U>(value)); }
+
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+
+    T take() {
+        if (result.index() == 2) {
+            std::rethrow_exception(std::get<2>(result));
+        }
+        return std::move(std::get<1>(result));
+    }
+};
+
+template<>
+struct TaskPromise<void> : PromiseBase {
+    std::exception_ptr error;
+
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    void take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+} // namespace detail
+
+// 惰性协程：创建时不执行，co_await 时在等待方所在线程开始运行，结果或异常交给等待方。
+// 只可移动；析构时销毁协程帧，因此必须等到它运行结束（co_await 返回）后才能丢弃
+template<class T>
+class Task {
+public:
+    typedef detail::TaskPromise<T> promise_type;
+
+    Task() noexcept : handle_(nullptr) {}
+
+    Task(Task&& other) noexcept : handle_(other.handle_) {
+        other.handle_ = nullptr;
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = other.handle_;
+            other.handle_ = nullptr;
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    bool valid() const noexcept { return handle_ != nullptr; }
+
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume() {
+            if (!handle) {
+                throw std::future_error(std::future_errc::no_state);
+            }
+            return handle.promise().take();
+        }
+    };
+
+    Awaiter operator co_await() const noexcept { return Awaiter{handle_}; }
+
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    void reset() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template<class T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// 等待 Future：就绪回调直接在完成方线程上恢复协程，等待期间不占用任何线程；
+// 需要回到线程池时再 co_await pool.schedule()
+template<class T>
+struct FutureAwaiter {
+    Future<T> future;
+
+    bool await_ready() const { return future.is_ready(); }
+
+    // 注册回调后不再访问 this：协程可能已在其他线程上恢复并销毁了本对象
+    void await_suspend(std::coroutine_handle<> handle) {
+        threadpool_detail::FutureAccess::state(future)->on_ready(::Task(Resume{handle}));
+    }
+
+    T await_resume() { return future.get(); }
+};
+
+// 立即开始、结束时自行销毁的协程，用来把 Task 的结果交给 Promise
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+template<class T>
+Detached complete(ThreadPool* pool, Task<T> task, Promise<T> promise) {
+    try {
+        if (pool) {
+            co_await pool->schedule();
+        }
+        if constexpr (std::is_void<T>::value) {
+            co_await task;
+            promise.set_value();
+        } else {
+            promise.set_value(co_await task);
+        }
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+// 在 pool 的工作线程上启动 task，返回其结果的 Future；可以与 then / when_all 组合
+template<class T>
+Future<T> spawn(ThreadPool& pool, Task<T> task) {
+    Promise<T> promise;
+    Future<T> result = promise.get_future();
+    detail::complete(&pool, std::move(task), std::move(promise));
+    return result;
+}
+
+// 在调用线程上启动 task 并阻塞等待结果；task 内部 co_await 的位置决定它之后在哪个线程继续
+template<class T>
+T sync_wait(Task<T> task) {
+    Promise<T> promise;
+    Future<T> result = promise.get_future();
+    detail::complete(static_cast<ThreadPool*>(nullptr), std::move(task), std::move(promise));
+    return result.get();
+}
+
+} // namespace coro
+
+inline coro::ScheduleAwaitable ThreadPool::schedule() {
+    return coro::ScheduleAwaitable(*this);
+}
+
+// co_await 线程池 Future：取走结果后 Future 失效，前驱的异常在 co_await 处重新抛出
+template<class T>
+coro::detail::FutureAwaiter<T> operator co_await(Future<T>&& future) {
+    return coro::detail::FutureAwaiter<T>{std::move(future)};
+}
@@ -0,0 +1,465 @@
+// TimingWheel.hpp
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace threadpool_detail {
+
+// 分层时间轮：第 0 层 256 格，每格一个 tick；第 1~3 层各 64 格，每格覆盖下一层一整圈。
+// 定时器挂在格子的侵入式双向链表上，插入、取消都是 O(1)；
+// 每走完一圈，上一层对应的格子整格下放（按到期 tick 重新插入），到期时一定已落在第 0 层。
+// 超出总跨度（2^26 个 tick）的定时器先挂在第 3 层最远的格子，下放时再重新计算。
+// 只在 TimerService 的锁内访问，本身不加锁
+class TimingWheel {
+public:
+    typedef uint32_t Index;
+    static const Index kNil = 0xffffffffu;
+
+    struct Entry {
+        Task task;
+        int64_t deadline;      // 到期 tick
+        int64_t period;        // 周期（tick），0 表示一次性
+        Index prev;
+        Index next;
+        uint32_t generation;   // 每次释放加 1，旧句柄随之失效
+        uint16_t slot;         // 所在格子；kDetached 表示不在轮上（空闲或正在执行）
+        bool canceled;         // 周期任务执行期间被取消
+    };
+
+    static const uint16_t kDetached = 0xffff;
+
+    TimingWheel() : current_(0), size_(0), free_(kNil) {
+        for (size_t i = 0; i < kSlots; ++i) {
+            heads_[i] = kNil;
+        }
+    }
+
+    // 已处理到的 tick；插入时以它为基准计算所在层
+    int64_t current() const { return current_; }
+
+    // 轮上的定时器数（不含正在执行的周期任务）
+    size_t size() const { return size_; }
+
+    Entry& entry(Index index) { return entries_[index]; }
+    const Entry& entry(Index index) const { return entries_[index]; }
+
+    // 曾经分配过的条目数（含空闲）
+    size_t capacity() const { return entries_.size(); }
+
+    Index acquire(Task&& task, int64_t period) {
+        Index index;
+        if (free_ != kNil) {
+            index = free_;
+            free_ = entries_[index].next;
+        } else {
+            if (entries_.size() >= kNil) {
+                throw std::length_error("TimingWheel: too many timers");
+            }
+            index = static_cast<Index>(entries_.size());
+            Entry fresh;
+            fresh.deadline = 0;
+            fresh.period = 0;
+            fresh.prev = fresh.next = kNil;
+            fresh.generation = 0;
+            fresh.slot = kDetached;
+            fresh.canceled = false;
+            entries_.push_back(std::move(fresh));
+        }
+        Entry& e = entries_[index];
+        e.task = std::move(task);
+        e.period = period;
+        e.canceled = false;
+        return index;
+    }
+
+    // 释放条目：回调随之析构，句柄失效
+    void release(Index index) {
+        Entry& e = entries_[index];
+        e.task.reset();
+        ++e.generation;
+        e.slot = kDetached;
+        e.next = free_;
+        free_ = index;
+    }
+
+    // 挂到轮上；已经到期的挂在下一个 tick
+    void schedule(Index index, int64_t deadline) {
+        Entry& e = entries_[index];
+        e.deadline = deadline;
+        link(index, slot_for(std::max(deadline, current_ + 1)));
+        ++size_;
+    }
+
+    // 从轮上摘下（取消）
+    void unschedule(Index index) {
+        unlink(index);
+        --size_;
+    }
+
+    // 推进到 now（含），对每个到期条目调用 on_due(index)；调用时条目已从轮上摘下
+    template<class OnDue>
+    void advance(int64_t now, OnDue&& on_due) {
+        if (size_ == 0) {
+            current_ = std::max(current_, now);
+            return;
+        }
+        while (current_ < now) {
+            ++current_;
+            // 一圈走完：从高层到低层依次下放当前格
+            if ((current_ & kLevel0Mask) == 0) {
+                int top = 1;
+                while (top < kLevels - 1 && ((current_ >> shift(top)) & kLevelMask) == 0) {
+                    ++top;
+                }
+                for (int level = top; level >= 1; --level) {
+                    cascade(slot_index(level, (current_ >> shift(level)) & kLevelMask));
+                }
+            }
+            uint16_t slot = static_cast<uint16_t>(current_ & kLevel0Mask);
+            Index index;
+            while ((index = heads_[slot]) != kNil) {
+                unlink(index);
+                --size_;
+                on_due(index);
+            }
+            if (size_ == 0) {
+                current_ = std::max(current_, now);
+                return;
+            }
+        }
+    }
+
+    // 下一次需要推进的 tick：本圈内最近的非空格，否则是下一圈的起点（要下放上层）；轮为空时返回最大值
+    int64_t next_due() const {
+        if (size_ == 0) {
+            return std::numeric_limits<int64_t>::max();
+        }
+        int64_t end = (current_ | kLevel0Mask) + 1;
+        for (int64_t t = current_ + 1; t < end; ++t) {
+            if (heads_[t & kLevel0Mask] != kNil) {
+                return t;
+            }
+        }
+        return end;
+    }
+
+private:
+    static const int kLevels = 4;
+    static const int kLevel0Bits = 8;
+    static const int kLevelBits = 6;
+    static const int64_t kLevel0Mask = (1 << kLevel0Bits) - 1;
+    static const int64_t kLevelMask = (1 << kLevelBits) - 1;
+    static const size_t kSlots = (1 << kLevel0Bits) + (kLevels - 1) * (1 << kLevelBits);
+
+    static int shift(int level) { return kLevel0Bits + (level - 1) * kLevelBits; }
+
+    static uint16_t slot_index(int level, int64_t index) {
+        return static_cast<uint16_t>(level == 0 ? index : (1 << kLevel0Bits) + (level - 1) * (1 << kLevelBits) + index);
+    }
+
+    uint16_t slot_for(int64_t deadline) const {
+        int64_t delta = deadline - current_;
+        if (delta <= kLevel0Mask) {
+            return slot_index(0, deadline & kLevel0Mask);
+        }
+        for (int level = 1; level < kLevels; ++level) {
+            if (delta < (int64_t(1) << (shift(level) + kLevelBits))) {
+                return slot_index(level, (deadline >> shift(level)) & kLevelMask);
+            }
+        }
+        // 超出跨度：挂在第 3 层最远的格子，届时重新计算
+        int top = kLevels - 1;
+        return slot_index(top, ((current_ >> shift(top)) + kLevelMask) & kLevelMask);
+    }
+
+    void link(Index index, uint16_t slot) {
+        Entry& e = entries_[index];
+        e.slot = slot;
+        e.prev = kNil;
+        e.next = heads_[slot];
+        if (e.next != kNil) {
+            entries_[e.next].prev = index;
+        }
+        heads_[slot] = index;
+    }
+
+    void unlink(Index index) {
+        Entry& e = entries_[index];
+        if (e.prev != kNil) {
+            entries_[e.prev].next = e.next;
+        } else {
+            heads_[e.slot] = e.next;
+        }
+        if (e.next != kNil) {
+            entries_[e.next].prev = e.prev;
+        }
+        e.prev = e.next = kNil;
+        e.slot = kDetached;
+    }
+
+    void cascade(uint16_t slot) {
+        Index index = heads_[slot];
+        heads_[slot] = kNil;
+        while (index != kNil) {
+            Index next = entries_[index].next;
+            link(index, slot_for(std::max(entries_[index].deadline, current_)));
+            index = next;
+        }
+    }
+
+    Index heads_[kSlots];
+    std::deque<Entry> entries_;   // deque 扩容时不移动已有条目，执行中的周期任务可在锁外引用
+    int64_t current_;
+    size_t size_;
+    Index free_;                  // 空闲条目链表（复用 next 字段）
+};
+
+} // namespace threadpool_detail
+
+// 定时任务句柄，用于取消
+struct TimerId {
+    uint32_t index;
+    uint32_t generation;
+};
+
+// 延迟与周期任务：一个定时线程维护时间轮，到期的任务成批投递到线程池执行，等待期间不占用工作线程。
+// 精度为一个 tick（默认 1 毫秒），任务不会早于指定时间执行。
+// 周期任务按固定频率排期，但同一个任务不会重叠执行：上一次执行结束后才排下一次，落后时立即补一次
+class TimerService {
+public:
+    explicit TimerService(ThreadPool& pool, std::chrono::microseconds tick = std::chrono::milliseconds(1))
+        : pool_(&pool), tick_ns_(std::max<int64_t>(1000, std::chrono::duration_cast<std::chrono::nanoseconds>(tick).count())),
+          start_(std::chrono::steady_clock::now()), wake_tick_(std::numeric_limits<int64_t>::max()),
+          running_(0), stop_(false) {
+        thread_ = std::thread(&TimerService::timer_loop, this);
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    // 尚未到期的任务被丢弃；等待已投递的周期任务结束（它们引用着本对象）
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [this]() { return running_ == 0; });
+    }
+
+    template<class Rep, class Period, class F>
+    TimerId schedule_after(const std::chrono::duration<Rep, Period>& delay, F&& f) {
+        return add(std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay),
+                   0, Task(std::forward<F>(f)));
+    }
+
+    template<class F>
+    TimerId schedule_at(std::chrono::steady_clock::time_point when, F&& f) {
+        return add(when, 0, Task(std::forward<F>(f)));
+    }
+
+    // 第一次在一个周期之后执行
+    template<class Rep, class Period, class F>
+    TimerId schedule_every(const std::chrono::duration<Rep, Period>& period, F&& f) {
+        int64_t ticks = std::max<int64_t>(1, to_ticks_ceil(std::chrono::duration_cast<std::chrono::nanoseconds>(period).count()));
+        return add(std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(period),
+                   ticks, Task(std::forward<F>(f)));
+    }
+
+    // 成功取消返回 true；任务已投递（一次性）或句柄已失效时返回 false。
+    // 周期任务正在执行时取消，本次执行照常完成，之后不再排期
+    bool cancel(TimerId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!valid(id)) {
+            return false;
+        }
+        threadpool_detail::TimingWheel::Entry& e = wheel_.entry(id.index);
+        if (e.slot == threadpool_detail::TimingWheel::kDetached) {
+            if (e.canceled) {
+                return false;
+            }
+            e.canceled = true;
+            return true;
+        }
+        wheel_.unschedule(id.index);
+        wheel_.release(id.index);
+        return true;
+    }
+
+    // 时间轮上等待到期的任务数
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return wheel_.size();
+    }
+
+private:
+    typedef threadpool_detail::TimingWheel::Index Index;
+
+    // 周期任务的一次执行：回调留在条目里（deque 中的地址不变，执行期间只有这里访问它），
+    // 执行结束（或任务被丢弃）时交还定时线程重新排期
+    struct PeriodicRun {
+        TimerService* service;
+        Index index;
+        Task* task;
+
+        PeriodicRun(TimerService* s, Index i, Task* t) : service(s), index(i), task(t) {}
+        PeriodicRun(PeriodicRun&& other) noexcept : service(other.service), index(other.index), task(other.task) {
+            other.service = nullptr;
+        }
+        PeriodicRun(const PeriodicRun&) = delete;
+
+        ~PeriodicRun() {
+            if (service) {
+                service->finish_periodic(index, false);
+            }
+        }
+
+        void operator()() {
+            TimerService* s = service;
+            service = nullptr;
+            try {
+                (*task)();
+            } catch (...) {
+                s->finish_periodic(index, true);
+                throw;
+            }
+            s->finish_periodic(index, true);
+        }
+    };
+
+    int64_t to_ticks_ceil(int64_t ns) const {
+        return ns <= 0 ? 0 : (ns + tick_ns_ - 1) / tick_ns_;
+    }
+
+    int64_t tick_of(std::chrono::steady_clock::time_point when) const {
+        return to_ticks_ceil(std::chrono::duration_cast<std::chrono::nanoseconds>(when - start_).count());
+    }
+
+    int64_t now_tick() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count() / tick_ns_;
+    }
+
+    std::chrono::steady_clock::time_point time_of(int64_t tick) const {
+        return start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(tick * tick_ns_));
+    }
+
+    // 条目释放时 generation 加 1，已执行或已取消的句柄不再匹配
+    bool valid(TimerId id) const {
+        return id.index < wheel_.capacity() && wheel_.entry(id.index).generation == id.generation;
+    }
+
+    TimerId add(std::chrono::steady_clock::time_point when, int64_t period, Task&& task) {
+        int64_t deadline = tick_of(when);
+        bool wake = false;
+        TimerId id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) {
+                throw std::runtime_error("schedule called on stopped TimerService");
+            }
+            Index index = wheel_.acquire(std::move(task), period);
+            wheel_.schedule(index, deadline);
+            id.index = index;
+            id.generation = wheel_.entry(index).generation;
+            wake = deadline < wake_tick_;
+        }
+        if (wake) {
+            cv_.notify_one();
+        }
+        return id;
+    }
+
+    // 周期任务执行结束：按原定节奏排下一次，已落后则排在下一个 tick；被取消或已停止则释放
+    void finish_periodic(Index index, bool ran) {
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            threadpool_detail::TimingWheel::Entry& e = wheel_.entry(index);
+            if (!ran || e.canceled || stop_) {
+                wheel_.release(index);
+            } else {
+                int64_t next = std::max(e.deadline + e.period, now_tick() + 1);
+                wheel_.schedule(index, next);
+                wake = next < wake_tick_;
+            }
+            --running_;
+            if (running_ == 0) {
+                idle_cv_.notify_all();
+            }
+        }
+        if (wake) {
+            cv_.notify_one();
+        }
+    }
+
+    void timer_loop() {
+        std::vector<Task> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            wheel_.advance(now_tick(), [this, &batch](Index index) {
+                threadpool_detail::TimingWheel::Entry& e = wheel_.entry(index);
+                if (e.period == 0) {
+                    batch.push_back(std::move(e.task));
+                    wheel_.release(index);
+                } else {
+                    ++running_;
+                    batch.push_back(Task(PeriodicRun(this, index, &e.task)));
+                }
+            });
+            if (!batch.empty()) {
+                // 投递期间不等待，投递完会重新推进，新任务无需唤醒
+                wake_tick_ = std::numeric_limits<int64_t>::min();
+                lock.unlock();
+                dispatch(batch);
+                lock.lock();
+                continue;
+            }
+            wake_tick_ = wheel_.next_due();
+            if (wake_tick_ == std::numeric_limits<int64_t>::max()) {
+                cv_.wait(lock);
+            } else {
+                cv_.wait_until(lock, time_of(wake_tick_));
+            }
+        }
+    }
+
+    // 整批一次入队；不受有界队列容量限制，定时线程不能被拒绝策略阻塞。线程池已停止时丢弃
+    void dispatch(std::vector<Task>& batch) {
+        try {
+            pool_->enqueue_batch(batch.size(), [&batch](size_t i) { return std::move(batch[i]); },
+                                 ThreadPool::AdmitMode::force);
+        } catch (...) {
+        }
+        batch.clear();
+    }
+
+    ThreadPool* pool_;
+    const int64_t tick_ns_;
+    const std::chrono::steady_clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    threadpool_detail::TimingWheel wheel_;
+    int64_t wake_tick_;       // 定时线程计划醒来的 tick；更早的新任务需要唤醒它
+    size_t running_;          // 已投递、尚未结束的周期任务
+    bool stop_;
+    std::thread thread_;
+};
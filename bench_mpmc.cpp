@@ -0,0 +1,150 @@
+// bench_mpmc.cpp
+// 提交队列竞争基准：1~32 个生产者线程下，
+// 1) 互斥锁 + std::queue 与无锁 MpmcQueue 的入队吞吐
+// 2) ThreadPool 分别使用 SubmitQueue::mutex / SubmitQueue::lock_free 时 post 的吞吐
+#include "ThreadPool.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+const size_t kItems = 1 << 20;          // 每轮入队总数
+const size_t kConsumers = 2;
+const size_t kRingCapacity = 1 << 12;
+
+// 原来的全局队列：std::queue + 互斥锁
+class MutexQueue {
+public:
+    bool try_push(size_t&& v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push(v);
+        return true;
+    }
+    bool try_pop(size_t& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        out = queue_.front();
+        queue_.pop();
+        return true;
+    }
+private:
+    std::mutex mutex_;
+    std::queue<size_t> queue_;
+};
+
+// 生产者同时起跑，消费者并发取走，返回每秒入队数
+template<class Queue>
+double run_queue(Queue& queue, size_t producers) {
+    std::atomic<bool> go(false);
+    std::atomic<size_t> consumed(0);
+    std::vector<std::thread> threads;
+    size_t per_producer = kItems / producers;
+    size_t total = per_producer * producers;
+
+    for (size_t c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&]() {
+            size_t v;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (queue.try_pop(v)) {
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per_producer; ++i) {
+                size_t v = p * per_producer + i;
+                while (!queue.try_push(std::move(v))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    go = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return total / seconds;
+}
+
+double run_pool(SubmitQueue kind, size_t producers) {
+    ThreadPoolOptions options;
+    options.min_threads = kConsumers;
+    options.max_threads = kConsumers;
+    options.submit_queue = kind;
+    options.submit_ring_capacity = kRingCapacity;
+    ThreadPool pool(options);
+
+    const size_t tasks = kItems / 4;
+    size_t per_producer = tasks / producers;
+    size_t total = per_producer * producers;
+    std::atomic<size_t> done(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per_producer; ++i) {
+                pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    go = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    while (done.load() < total) {
+        std::this_thread::yield();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return total / seconds;
+}
+
+} // namespace
+
+int main() {
+    const size_t producer_counts[] = {1, 2, 4, 8, 16, 32};
+
+    std::cout << "硬件并发数: " << std::thread::hardware_concurrency()
+              << "，消费者: " << kConsumers << "，环形队列容量: " << kRingCapacity << std::endl;
+
+    std::cout << "\n=== 队列入队吞吐（百万次/秒）===" << std::endl;
+    std::cout << std::setw(10) << "生产者" << std::setw(14) << "mutex" << std::setw(14) << "mpmc" << std::endl;
+    for (size_t producers : producer_counts) {
+        MutexQueue locked;
+        MpmcQueue<size_t> ring(kRingCapacity);
+        double a = run_queue(locked, producers);
+        double b = run_queue(ring, producers);
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << producers << std::setw(14) << a / 1e6 << std::setw(14) << b / 1e6 << std::endl;
+    }
+
+    std::cout << "\n=== ThreadPool::post 吞吐（百万任务/秒）===" << std::endl;
+    std::cout << std::setw(10) << "生产者" << std::setw(14) << "mutex" << std::setw(14) << "lock_free" << std::endl;
+    for (size_t producers : producer_counts) {
+        double a = run_pool(SubmitQueue::mutex, producers);
+        double b = run_pool(SubmitQueue::lock_free, producers);
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << producers << std::setw(14) << a / 1e6 << std::setw(14) << b / 1e6 << std::endl;
+    }
+    return 0;
+}
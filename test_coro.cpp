@@ -0,0 +1,274 @@
+// test_coro.cpp —— 协程接口测试，需要 C++20（make coro）
+#include "ThreadPoolCoro.hpp"
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+// ==========================================
+// 分配计数：协程会在线程之间迁移，这里用全局原子计数统计所有线程的堆分配
+// ==========================================
+static std::atomic<size_t> g_alloc_count(0);
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// ==========================================
+// 测试1：co_await pool.schedule() 切换到工作线程
+// ==========================================
+coro::Task<size_t> hopMany(ThreadPool& pool, int hops, std::thread::id caller, bool& on_worker) {
+    co_await pool.schedule();
+    on_worker = std::this_thread::get_id() != caller;
+    size_t before = g_alloc_count.load();
+    for (int i = 0; i < hops; ++i) {
+        co_await pool.schedule();
+    }
+    co_return g_alloc_count.load() - before;
+}
+
+void testScheduleHop() {
+    std::cout << "=== 🦘 协程切换线程测试 ===" << std::endl;
+    std::cout << "目标：co_await pool.schedule() 把协程移到工作线程上，每次切换不产生堆分配" << std::endl;
+
+    ThreadPool pool(4, 4);
+    const int HOPS = 100000;
+    bool on_worker = false;
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t allocs = coro::sync_wait(hopMany(pool, HOPS, std::this_thread::get_id(), on_worker));
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+
+    // 工作线程本地队列初次增长会分配几次，之后复用
+    bool alloc_ok = allocs * 100 < static_cast<size_t>(HOPS);
+
+    std::cout << "✓ 协程切换线程测试完成" << std::endl;
+    std::cout << "  " << HOPS << " 次切换，平均 " << elapsed_ns / HOPS << " ns/次，共分配 " << allocs
+              << " 次 | 运行于工作线程: " << (on_worker ? "是" : "否") << std::endl;
+    assert(on_worker && alloc_ok);
+}
+
+// ==========================================
+// 测试2：惰性 Task 组合、异常传递与对称转移
+// ==========================================
+coro::Task<int> leaf(int value, std::atomic<int>& started) {
+    started.fetch_add(1);
+    co_return value;
+}
+
+coro::Task<int> failing() {
+    throw std::runtime_error("coroutine failure");
+    co_return 0;
+}
+
+coro::Task<void> touch(std::atomic<int>& counter) {
+    counter.fetch_add(1);
+    co_return;
+}
+
+coro::Task<long> chain(int depth) {
+    // 每一层都同步完成：对称转移保证调用栈不会随深度增长（恢复靠尾调用，需开启优化，sanitizer 构建下不成立）
+    std::atomic<int> started(0);
+    long sum = 0;
+    for (int i = 0; i < depth; ++i) {
+        sum += co_await leaf(1, started);
+    }
+    co_return sum;
+}
+
+coro::Task<int> compose(ThreadPool& pool, std::atomic<int>& started, bool& lazy_ok, bool& caught) {
+    coro::Task<int> pending = leaf(40, started);
+    lazy_ok = started.load() == 0;
+    co_await pool.schedule();
+    int value = co_await pending;
+    value += co_await leaf(2, started);
+    try {
+        co_await failing();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    std::atomic<int> touched(0);
+    co_await touch(touched);
+    co_return value + touched.load() - 1;
+}
+
+void testTaskComposition() {
+    std::cout << "\n=== 🧩 协程 Task 组合测试 ===" << std::endl;
+    std::cout << "目标：Task 惰性启动，结果与异常沿 co_await 传回，深层同步完成的链不会爆栈" << std::endl;
+
+    ThreadPool pool(2, 2);
+    std::atomic<int> started(0);
+    bool lazy_ok = false;
+    bool caught = false;
+    int value = coro::sync_wait(compose(pool, started, lazy_ok, caught));
+
+    const int DEPTH = 1000000;
+    long deep = coro::sync_wait(chain(DEPTH));
+
+    // spawn 得到的 Future 可以直接交给 then / get
+    bool spawn_threw = false;
+    try {
+        coro::spawn(pool, failing()).get();
+    } catch (const std::runtime_error&) {
+        spawn_threw = true;
+    }
+    int spawned = coro::spawn(pool, leaf(7, started))
+        .then(pool, [](Future<int> f) { return f.get() * 6; })
+        .get();
+
+    std::cout << "✓ 协程 Task 组合测试完成" << std::endl;
+    std::cout << "  惰性启动: " << (lazy_ok ? "通过" : "失败") << " | 结果: " << value
+              << " | 异常: " << (caught && spawn_threw ? "通过" : "失败") << " | " << DEPTH
+              << " 层同步链: " << deep << " | spawn + then: " << spawned << std::endl;
+    assert(lazy_ok && value == 42 && caught && spawn_threw && deep == DEPTH && spawned == 42);
+}
+
+// ==========================================
+// 测试3：数千个挂起的协程只占用少量线程
+// ==========================================
+coro::Task<int> awaitIo(ThreadPool& pool, Future<int> io, std::atomic<int>& suspended) {
+    suspended.fetch_add(1);
+    int value = co_await std::move(io);
+    co_await pool.schedule();
+    co_return value * 2;
+}
+
+void testThousandsSuspended() {
+    std::cout << "\n=== 💤 大量挂起协程测试 ===" << std::endl;
+    std::cout << "目标：10000 个等待 I/O 的协程同时挂起，2 个工作线程即可全部完成" << std::endl;
+
+    ThreadPool pool(2, 2);
+    const int OPS = 10000;
+    std::atomic<int> suspended(0);
+    std::vector<Promise<int>> io(OPS);
+    std::vector<Future<int>> results;
+    results.reserve(OPS);
+    for (int i = 0; i < OPS; ++i) {
+        results.push_back(coro::spawn(pool, awaitIo(pool, io[i].get_future(), suspended)));
+    }
+    while (suspended.load() < OPS) {
+        std::this_thread::yield();
+    }
+    // 全部挂起时线程池仍然空闲：等待 I/O 不占用工作线程
+    bool probe_ok = pool.submit([]() { return 1; }).get() == 1;
+    size_t threads = pool.get_thread_count();
+
+    // 模拟 I/O 线程逐个完成
+    auto start = std::chrono::high_resolution_clock::now();
+    std::thread completer([&io]() {
+        for (int i = 0; i < OPS; ++i) {
+            io[i].set_value(i);
+        }
+    });
+    completer.join();
+    long long sum = when_all(std::move(results)).then(pool, [](Future<std::vector<Future<int>>> all) {
+        long long s = 0;
+        for (auto& f : all.get()) { s += f.get(); }
+        return s;
+    }).get();
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    long long expected = static_cast<long long>(OPS) * (OPS - 1);
+
+    std::cout << "✓ 大量挂起协程测试完成" << std::endl;
+    std::cout << "  " << OPS << " 个协程挂起时线程数: " << threads << " | 线程池仍可响应: "
+              << (probe_ok ? "是" : "否") << " | 恢复并汇总耗时 " << elapsed_ms << " ms | 结果: "
+              << (sum == expected ? "通过" : "失败") << std::endl;
+    assert(probe_ok && threads == 2 && sum == expected);
+}
+
+// ==========================================
+// 测试4：有界队列已满时 co_await pool.schedule() 仍然入队
+// ==========================================
+coro::Task<bool> hopFromCaller(ThreadPool& pool, std::thread::id caller) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id() != caller;
+}
+
+void testScheduleOnFullPool() {
+    std::cout << "\n=== 🚧 满队列协程切换测试 ===" << std::endl;
+    std::cout << "目标：队列已满时恢复任务不走拒绝策略，既不丢弃排队任务，也不在提交线程上内联恢复" << std::endl;
+
+    const RejectionPolicy policies[] = { RejectionPolicy::discard_oldest, RejectionPolicy::caller_runs };
+    const char* names[] = { "discard_oldest", "caller_runs" };
+    for (int p = 0; p < 2; ++p) {
+        ThreadPoolOptions options;
+        options.min_threads = 1;
+        options.max_threads = 1;
+        options.queue_capacity = 4;
+        options.rejection_policy = policies[p];
+        ThreadPool pool(options);
+
+        // 闸门任务占住唯一的工作线程，再排入 4 个任务把队列填满
+        std::atomic<bool> gate(false);
+        std::atomic<bool> started(false);
+        std::atomic<int> fillers(0);
+        pool.post([&gate, &started]() {
+            started = true;
+            while (!gate.load()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        });
+        while (!started.load()) {
+            std::this_thread::yield();
+        }
+        for (int i = 0; i < 4; ++i) {
+            pool.post([&fillers]() { fillers++; });
+        }
+
+        Future<bool> hopped = coro::spawn(pool, hopFromCaller(pool, std::this_thread::get_id()));
+        gate = true;
+        bool on_worker = hopped.get();
+        for (int i = 0; i < 2000 && fillers.load() < 4; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bool ok = on_worker && fillers.load() == 4 && pool.get_discarded_count() == 0;
+
+        std::cout << "  " << names[p] << "：运行于工作线程: " << (on_worker ? "是" : "否")
+                  << " | 排队任务执行 " << fillers.load() << "/4 | 丢弃 " << pool.get_discarded_count() << std::endl;
+        assert(ok);
+    }
+    std::cout << "✓ 满队列协程切换测试完成" << std::endl;
+}
+
+int main() {
+    std::cout << "==========================================" << std::endl;
+    std::cout << "   C++20 协程接口测试" << std::endl;
+    std::cout << "==========================================" << std::endl;
+
+    auto global_start = std::chrono::high_resolution_clock::now();
+
+    try {
+        testScheduleHop();
+        testTaskComposition();
+        testThousandsSuspended();
+        testScheduleOnFullPool();
+
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - global_start);
+
+        std::cout << "\n==========================================" << std::endl;
+        std::cout << "   🎉 所有协程测试通过！总耗时: " << total_ms.count() << " ms" << std::endl;
+        std::cout << "==========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ 测试失败: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
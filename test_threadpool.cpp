@@ -2,6 +2,9 @@
 #include "ThreadPool.hpp"
 // extreme_stress_test_combined.cpp
 #include "ThreadPool.hpp" // 请确保包含你的ThreadPool头文件
+#include "TaskGraph.hpp"
+#include "TaskGroup.hpp"
+#include "TimingWheel.hpp"
 #include <iostream>
 #include <atomic>
 #include <vector>
@@ -12,6 +15,35 @@
 #include <mutex>
 #include <condition_variable>
 #include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+
+// ==========================================
+// 分配计数：统计当前线程的堆分配次数，用于衡量 submit 路径的开销
+// ==========================================
+// 替换全局 operator new/delete；禁止内联，避免编译器把 free 与 new 配对误报
+static thread_local size_t t_alloc_count = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    ++t_alloc_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
 
 // ==========================================
 // 测试1：千万级任务洪峰测试
@@ -21,17 +53,25 @@ void testMillionTaskFlood() {
     std::cout << "目标：1000万任务，检验内存管理和调度极限" << std::endl;
     
     const size_t num_tasks = 10000000;
-    ThreadPool pool(16, 64, std::chrono::milliseconds(1000));
+    ThreadPoolOptions options;
+    options.min_threads = 16;
+    options.max_threads = 64;
+    options.min_stable_time = std::chrono::milliseconds(1000);
+    options.latency_histograms = true;
+    ThreadPool pool(options);
     
     std::atomic<long> completed_tasks(0);
     std::atomic<long long> total_execution_time(0);
-    std::vector<std::future<long long>> futures;
+    std::vector<Future<long long>> futures;
     futures.reserve(100000);
     
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dis(1, 100);
     
+    size_t submit_allocs = 0;
+    long long submit_ns = 0;
+    
     auto start = std::chrono::high_resolution_clock::now();
     
     // 分批提交策略，避免内存爆炸
@@ -42,7 +82,9 @@ void testMillionTaskFlood() {
             futures.clear();
         }
         
-        futures.push_back(pool.submit([&completed_tasks, &total_execution_time, i, &dis, &gen]() -> long long {
+        size_t allocs_before = t_alloc_count;
+        auto submit_start = std::chrono::steady_clock::now();
+        auto future = pool.submit([&completed_tasks, &total_execution_time, i, &dis, &gen]() -> long long {
             auto task_start = std::chrono::high_resolution_clock::now();
             
             // 混合任务类型
@@ -72,7 +114,11 @@ switch(task_type) {
             total_execution_time += duration;
             completed_tasks++;
             return result;
-        }));
+        });
+        submit_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - submit_start).count();
+        submit_allocs += t_alloc_count - allocs_before;
+        futures.push_back(std::move(future));
     }
     
     // 等待最终批次
@@ -86,6 +132,13 @@ switch(task_type) {
     std::cout << "  总耗时: " << total_duration.count() << " ms" << std::endl;
     std::cout << "  吞吐量: " << (num_tasks * 1000.0 / total_duration.count()) << " tasks/sec" << std::endl;
     std::cout << "  平均耗时: " << (total_execution_time / num_tasks) << " μs" << std::endl;
+    LatencyStats latency = pool.latency();
+    std::cout << "  排队时间: p50 " << latency.queue_wait.p50() / 1000.0 << " μs | p99 "
+              << latency.queue_wait.p99() / 1000.0 << " μs | p99.9 " << latency.queue_wait.p999() / 1000.0 << " μs" << std::endl;
+    std::cout << "  执行时间: p50 " << latency.execution.p50() / 1000.0 << " μs | p99 "
+              << latency.execution.p99() / 1000.0 << " μs | p99.9 " << latency.execution.p999() / 1000.0 << " μs" << std::endl;
+    std::cout << "  submit 平均耗时: " << (submit_ns / static_cast<long long>(num_tasks)) << " ns" << std::endl;
+    std::cout << "  submit 平均分配: " << (static_cast<double>(submit_allocs) / num_tasks) << " 次/任务" << std::endl;
 }
 
 // ==========================================
@@ -96,6 +149,15 @@ void testInstantBurstTraffic() {
     std::cout << "目标：3波5万并发，考验弹性扩缩容能力" << std::endl;
     
     ThreadPool pool(2, 100, std::chrono::milliseconds(500));
+    std::atomic<int> scale_ups(0);
+    std::atomic<int> scale_downs(0);
+    pool.set_scale_callback([&scale_ups, &scale_downs](const ScaleEvent& e) {
+        if (e.new_threads > e.old_threads) {
+            scale_ups++;
+        } else {
+            scale_downs++;
+        }
+    });
     
     const int BURST_SIZE = 50000;
     const int BURST_COUNT = 3;
@@ -105,7 +167,7 @@ void testInstantBurstTraffic() {
     for (int burst = 0; burst < BURST_COUNT; ++burst) {
         std::cout << "  突发波次 " << (burst + 1) << " - 提交 " << BURST_SIZE << " 任务..." << std::endl;
         
-        std::vector<std::future<int>> futures;
+        std::vector<Future<int>> futures;
         futures.reserve(BURST_SIZE);
         std::atomic<int> burst_completed(0);
         
@@ -142,9 +204,23 @@ void testInstantBurstTraffic() {
         total_time += duration.count();
     }
     
+    // 波次间隔短于冷却期，一般不会缩容（受调度影响，只打印不断言）；
+    // 负载消失后必须逐步缩回最小线程数，给足时间只断言最终结果
+    int downs_during_bursts = scale_downs.load();
+    auto idle_start = std::chrono::high_resolution_clock::now();
+    while (pool.get_thread_count() > 2 &&
+           std::chrono::high_resolution_clock::now() - idle_start < std::chrono::seconds(60)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    auto shrink_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - idle_start).count();
+    
     std::cout << "✓ 突发流量测试完成" << std::endl;
     std::cout << "  总处理任务: " << total_completed.load() << std::endl;
     std::cout << "  平均波次耗时: " << (total_time / BURST_COUNT) << " ms" << std::endl;
+    std::cout << "  扩容次数: " << scale_ups.load() << " | 波次间缩容: " << downs_during_bursts
+              << " | 空闲后 " << shrink_ms << " ms 缩回 " << pool.get_thread_count() << " 个线程" << std::endl;
+    assert(pool.get_thread_count() == 2);
 }
 
 // ==========================================
@@ -304,6 +380,1627 @@ void testBoundaryAndRobustness() {
     std::cout << "  混合任务 - 成功: " << mixed_success << " | 失败: " << mixed_failed << std::endl;
 }
 
+// ==========================================
+// 测试5：嵌套提交与工作窃取测试
+// ==========================================
+void testWorkStealing() {
+    std::cout << "\n=== 🧵 嵌套提交与工作窃取测试 ===" << std::endl;
+    std::cout << "目标：工作线程内部派生子任务，检验本地队列与窃取" << std::endl;
+
+    ThreadPool pool(4, 4, std::chrono::milliseconds(500));
+
+    const int PARENTS = 200;
+    const int CHILDREN = 500;
+    std::atomic<int> child_completed(0);
+    std::vector<Future<std::vector<Future<int>>>> parents;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int p = 0; p < PARENTS; ++p) {
+        parents.push_back(pool.submit([&pool, &child_completed, p]() {
+            // 子任务进入当前工作线程的本地队列，空闲线程从队头窃取
+            std::vector<Future<int>> children;
+            children.reserve(CHILDREN);
+            for (int c = 0; c < CHILDREN; ++c) {
+                children.push_back(pool.submit([&child_completed, p, c]() -> int {
+                    child_completed++;
+                    return p + c;
+                }));
+            }
+            return children;
+        }));
+    }
+
+    long long checksum = 0;
+    for (auto& parent : parents) {
+        auto children = parent.get();
+        for (auto& child : children) { checksum += child.get(); }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    long long expected = 0;
+    for (int p = 0; p < PARENTS; ++p) {
+        for (int c = 0; c < CHILDREN; ++c) { expected += p + c; }
+    }
+    bool ok = (child_completed == PARENTS * CHILDREN) && (checksum == expected);
+
+    std::cout << "✓ 工作窃取测试完成" << std::endl;
+    std::cout << "  耗时: " << duration.count() << " ms" << std::endl;
+    std::cout << "  子任务: " << (ok ? "通过" : "失败") << " ("
+              << child_completed.load() << "/" << (PARENTS * CHILDREN) << ")" << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试6：Future / Promise 语义测试
+// ==========================================
+void testFuturePromise() {
+    std::cout << "\n=== 🔮 Future / Promise 语义测试 ===" << std::endl;
+    std::cout << "目标：检验超时等待、未兑现的 Promise 与 std::future 转换" << std::endl;
+
+    ThreadPool pool(2, 4, std::chrono::milliseconds(500));
+
+    // 超时等待
+    Future<int> slow = pool.submit([]() -> int {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return 7;
+    });
+    bool timed_out = slow.wait_for(std::chrono::milliseconds(1)) == std::future_status::timeout;
+    bool value_ok = slow.get() == 7 && !slow.valid();
+
+    // 未兑现就销毁的 Promise
+    Future<std::string> orphan;
+    {
+        Promise<std::string> promise;
+        orphan = promise.get_future();
+    }
+    bool broken = false;
+    try {
+        orphan.get();
+    } catch (const std::future_error& e) {
+        broken = (e.code() == std::future_errc::broken_promise);
+    }
+
+    // 引用结果与 std::future 转换
+    int shared_value = 41;
+    Future<int&> ref = pool.submit([&shared_value]() -> int& { return shared_value; });
+    ref.get()++;
+    std::future<int> converted = pool.submit([&shared_value]() { return shared_value + 1; });
+    bool convert_ok = converted.get() == 43;
+
+    bool ok = timed_out && value_ok && broken && convert_ok;
+    std::cout << "✓ Future / Promise 测试完成" << std::endl;
+    std::cout << "  超时: " << (timed_out ? "通过" : "失败")
+              << " | 未兑现: " << (broken ? "通过" : "失败")
+              << " | 转换: " << (convert_ok ? "通过" : "失败") << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试7：批量提交测试
+// ==========================================
+void testBulkSubmission() {
+    std::cout << "\n=== 📦 批量提交测试 ===" << std::endl;
+    std::cout << "目标：100万任务逐个提交 vs 一次性批量提交，结果写入输出区间" << std::endl;
+
+    ThreadPool pool(8, 8, std::chrono::milliseconds(500));
+    const size_t N = 1000000;
+
+    // 逐个提交
+    auto single_start = std::chrono::high_resolution_clock::now();
+    std::vector<Future<long long>> futures;
+    futures.reserve(N);
+    for (size_t i = 0; i < N; ++i) {
+        futures.push_back(pool.submit([i]() -> long long { return static_cast<long long>(i) * 3; }));
+    }
+    long long single_sum = 0;
+    for (auto& f : futures) { single_sum += f.get(); }
+    auto single_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - single_start).count();
+
+    // 批量提交，结果直接写入输出区间，无需持有 N 个 Future
+    auto bulk_start = std::chrono::high_resolution_clock::now();
+    std::vector<long long> results(N);
+    pool.submit_n(N, [](size_t i) -> long long { return static_cast<long long>(i) * 3; },
+                  results.begin()).get();
+    long long bulk_sum = 0;
+    for (long long r : results) { bulk_sum += r; }
+    auto bulk_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - bulk_start).count();
+
+    // 区间版本与异常传播
+    std::vector<int> inputs(1000);
+    for (size_t i = 0; i < inputs.size(); ++i) { inputs[i] = static_cast<int>(i); }
+    std::vector<int> squares(inputs.size());
+    pool.submit_bulk(inputs.begin(), inputs.end(), [](int v) { return v * v; }, squares.begin()).get();
+    bool range_ok = true;
+    for (size_t i = 0; i < inputs.size(); ++i) { range_ok = range_ok && squares[i] == inputs[i] * inputs[i]; }
+
+    bool exception_ok = false;
+    try {
+        pool.submit_n(100, [](size_t i) {
+            if (i == 42) { throw std::runtime_error("批量任务异常"); }
+        }).get();
+    } catch (const std::runtime_error&) {
+        exception_ok = true;
+    }
+
+    bool ok = (single_sum == bulk_sum) && range_ok && exception_ok;
+    std::cout << "✓ 批量提交测试完成" << std::endl;
+    std::cout << "  逐个提交: " << single_ms << " ms | 批量提交: " << bulk_ms << " ms" << std::endl;
+    std::cout << "  结果校验: " << (ok ? "通过" : "失败") << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试8：并行循环与归约测试
+// ==========================================
+void testParallelLoops() {
+    std::cout << "\n=== 🔁 并行循环与归约测试 ===" << std::endl;
+    std::cout << "目标：1000万次廉价迭代，不为每个迭代创建任务" << std::endl;
+
+    ThreadPool pool(8, 8, std::chrono::milliseconds(500));
+    const long long N = 10000000;
+
+    // 串行基准
+    auto serial_start = std::chrono::high_resolution_clock::now();
+    long long serial_sum = 0;
+    for (long long i = 0; i < N; ++i) { serial_sum += (i * 7) % 13; }
+    auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - serial_start).count();
+
+    // 并行归约
+    auto reduce_start = std::chrono::high_resolution_clock::now();
+    long long parallel_sum = pool.parallel_reduce(0LL, N, 0LL,
+        [](long long i) { return (i * 7) % 13; },
+        [](long long a, long long b) { return a + b; });
+    auto reduce_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - reduce_start).count();
+
+    // 并行写入
+    std::vector<int> data(1000000);
+    pool.parallel_for(size_t(0), data.size(), [&data](size_t i) { data[i] = static_cast<int>(i % 97); });
+    bool for_ok = true;
+    for (size_t i = 0; i < data.size(); ++i) { for_ok = for_ok && data[i] == static_cast<int>(i % 97); }
+
+    // 异常传播
+    bool exception_ok = false;
+    try {
+        pool.parallel_for(0, 1000, [](int i) {
+            if (i == 500) { throw std::runtime_error("循环体异常"); }
+        });
+    } catch (const std::runtime_error&) {
+        exception_ok = true;
+    }
+
+    bool ok = (serial_sum == parallel_sum) && for_ok && exception_ok;
+    std::cout << "✓ 并行循环测试完成" << std::endl;
+    std::cout << "  串行: " << serial_ms << " ms | 并行归约: " << reduce_ms << " ms" << std::endl;
+    std::cout << "  结果校验: " << (ok ? "通过" : "失败") << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试9：post 无结果提交测试
+// ==========================================
+void testPostFireAndForget() {
+    std::cout << "\n=== 📮 post 无结果提交测试 ===" << std::endl;
+    std::cout << "目标：100万个 void 任务，对比 submit 与 post 的单任务开销" << std::endl;
+
+    ThreadPool pool(8, 8, std::chrono::milliseconds(500));
+    const int N = 1000000;
+
+    // submit：每个任务都有 Promise/Future
+    std::atomic<int> submitted(0);
+    auto submit_start = std::chrono::high_resolution_clock::now();
+    std::vector<Future<void>> futures;
+    futures.reserve(N);
+    for (int i = 0; i < N; ++i) {
+        futures.push_back(pool.submit([&submitted]() { submitted++; }));
+    }
+    for (auto& f : futures) { f.get(); }
+    auto submit_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - submit_start).count();
+
+    // post：队列里只有可调用对象
+    std::atomic<int> posted(0);
+    auto post_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; ++i) {
+        pool.post([&posted]() { posted++; });
+    }
+    while (posted.load() < N) { std::this_thread::yield(); }
+    auto post_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - post_start).count();
+
+    // 未处理异常交给线程池的异常回调
+    std::atomic<int> handled(0);
+    pool.set_exception_handler([&handled](std::exception_ptr e) {
+        try {
+            std::rethrow_exception(e);
+        } catch (const std::runtime_error&) {
+            handled++;
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        pool.post([]() { throw std::runtime_error("post 任务异常"); });
+    }
+    while (handled.load() < 100) { std::this_thread::yield(); }
+
+    bool ok = (submitted == N) && (posted == N) && (handled == 100);
+    std::cout << "✓ post 测试完成" << std::endl;
+    std::cout << "  submit: " << (submit_ns / N) << " ns/任务 | post: " << (post_ns / N) << " ns/任务" << std::endl;
+    std::cout << "  异常回调: " << (handled == 100 ? "通过" : "失败") << " (" << handled.load() << "/100)" << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试10：多级优先级调度测试
+// ==========================================
+void testPriorityScheduling() {
+    std::cout << "\n=== 🚦 多级优先级调度测试 ===" << std::endl;
+    std::cout << "目标：2万个批处理任务洪峰下，高优先级任务的排队时间保持平稳" << std::endl;
+
+    ThreadPool pool(2, 2, std::chrono::milliseconds(500));
+    const int FLOOD = 20000;
+    const int URGENT = 50;
+
+    auto busy = [](int micros) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(micros);
+        while (std::chrono::steady_clock::now() < until) {}
+    };
+
+    std::vector<Future<void>> flood;
+    flood.reserve(FLOOD);
+    for (int i = 0; i < FLOOD; ++i) {
+        flood.push_back(pool.submit(busy, 20));
+    }
+
+    // 低优先级任务在洪峰中也必须被执行到
+    Future<int> background = pool.submit_with_priority(TaskPriority::background, []() { return 1; });
+
+    std::vector<Future<void>> urgent;
+    for (int i = 0; i < URGENT; ++i) {
+        urgent.push_back(pool.submit_with_priority(TaskPriority::high, busy, 5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (auto& f : urgent) { f.get(); }
+    PriorityLevelStats normal_mid = pool.priority_stats(TaskPriority::normal);
+
+    bool background_ok = background.get() == 1;
+    for (auto& f : flood) { f.get(); }
+
+    PriorityLevelStats high = pool.priority_stats(TaskPriority::high);
+    PriorityLevelStats normal = pool.priority_stats(TaskPriority::normal);
+    double high_avg_us = high.total_wait_ns / 1000.0 / std::max<uint64_t>(high.dequeued, 1);
+    double normal_avg_us = normal.total_wait_ns / 1000.0 / std::max<uint64_t>(normal.dequeued, 1);
+
+    bool ok = background_ok && high.dequeued == static_cast<uint64_t>(URGENT) &&
+              high_avg_us < normal_avg_us && normal_mid.depth > 0;
+    std::cout << "✓ 优先级调度测试完成" << std::endl;
+    std::cout << "  高优先级: 平均排队 " << high_avg_us << " μs | 最长 " << (high.max_wait_ns / 1000) << " μs" << std::endl;
+    std::cout << "  普通优先级: 平均排队 " << normal_avg_us << " μs | 最长 " << (normal.max_wait_ns / 1000) << " μs" << std::endl;
+    std::cout << "  低优先级未饿死: " << (background_ok ? "通过" : "失败") << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试11：有界队列与拒绝策略测试
+// ==========================================
+void testBoundedQueue() {
+    std::cout << "\n=== 🚧 有界队列与拒绝策略测试 ===" << std::endl;
+    std::cout << "目标：容量16的队列在四种拒绝策略下都不会无限增长" << std::endl;
+
+    const size_t CAPACITY = 16;
+    auto make_options = [CAPACITY](RejectionPolicy policy) {
+        ThreadPoolOptions options;
+        options.min_threads = 1;
+        options.max_threads = 1;
+        options.min_stable_time = std::chrono::milliseconds(500);
+        options.queue_capacity = CAPACITY;
+        options.rejection_policy = policy;
+        return options;
+    };
+    // 用一个闸门任务占住唯一的工作线程，让后续任务留在队列里
+    auto block_worker = [](ThreadPool& pool, std::atomic<bool>& gate) {
+        std::atomic<bool> started(false);
+        pool.post([&gate, &started]() {
+            started = true;
+            while (!gate.load()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        });
+        while (!started.load()) { std::this_thread::yield(); }
+    };
+
+    // block：提交方被挡住，队列深度不超过容量
+    size_t max_depth = 0;
+    std::atomic<int> blocked_done(0);
+    {
+        ThreadPool pool(make_options(RejectionPolicy::block));
+        std::atomic<bool> gate(false);
+        block_worker(pool, gate);
+        std::thread producer([&pool, &blocked_done]() {
+            for (int i = 0; i < 200; ++i) {
+                pool.post([&blocked_done]() { blocked_done++; });
+            }
+        });
+        for (int i = 0; i < 50; ++i) {
+            max_depth = std::max(max_depth, pool.get_queue_size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        gate = true;
+        producer.join();
+        while (blocked_done.load() < 200) { std::this_thread::yield(); }
+    }
+
+    // caller_runs：队列满时任务在提交线程上执行
+    bool ran_on_caller = false;
+    {
+        ThreadPool pool(make_options(RejectionPolicy::caller_runs));
+        std::atomic<bool> gate(false);
+        block_worker(pool, gate);
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            pool.post([]() {});
+        }
+        auto caller = std::this_thread::get_id();
+        ran_on_caller = pool.submit([caller]() { return std::this_thread::get_id() == caller; }).get();
+        gate = true;
+    }
+
+    // discard_oldest：最低优先级中最老的任务被丢弃，其 Future 得到 broken_promise
+    bool oldest_broken = false;
+    size_t discarded = 0;
+    {
+        ThreadPool pool(make_options(RejectionPolicy::discard_oldest));
+        std::atomic<bool> gate(false);
+        block_worker(pool, gate);
+        Future<int> victim = pool.submit_with_priority(TaskPriority::background, []() { return 1; });
+        for (size_t i = 1; i < CAPACITY; ++i) {
+            pool.post([]() {});
+        }
+        Future<int> newest = pool.submit([]() { return 2; });
+        gate = true;
+        try {
+            victim.get();
+        } catch (const std::future_error& e) {
+            oldest_broken = e.code() == std::future_errc::broken_promise;
+        }
+        oldest_broken = oldest_broken && newest.get() == 2;
+        discarded = pool.get_discarded_count();
+    }
+
+    // throw_exception：submit 抛出 TaskRejectedError，try_submit / submit_for 返回无效 Future
+    bool threw = false;
+    bool try_rejected = false;
+    bool timed_rejected = false;
+    size_t rejected = 0;
+    {
+        ThreadPool pool(make_options(RejectionPolicy::throw_exception));
+        std::atomic<bool> gate(false);
+        block_worker(pool, gate);
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            pool.post([]() {});
+        }
+        try {
+            pool.submit([]() {});
+        } catch (const TaskRejectedError&) {
+            threw = true;
+        }
+        try_rejected = !pool.try_submit([]() {}).valid();
+        timed_rejected = !pool.submit_for(std::chrono::milliseconds(20), []() {}).valid();
+        rejected = pool.get_rejected_count();
+        gate = true;
+    }
+
+    bool ok = max_depth <= CAPACITY && blocked_done == 200 && ran_on_caller &&
+              oldest_broken && discarded == 1 && threw && try_rejected && timed_rejected && rejected == 3;
+    std::cout << "✓ 有界队列测试完成" << std::endl;
+    std::cout << "  block: 最大队列深度 " << max_depth << "/" << CAPACITY
+              << " | caller_runs: " << (ran_on_caller ? "通过" : "失败")
+              << " | discard_oldest: " << (oldest_broken ? "通过" : "失败")
+              << " | throw: " << (threw && try_rejected && timed_rejected ? "通过" : "失败") << std::endl;
+    assert(ok);
+}
+
+// ==========================================
+// 测试12：无锁提交队列测试
+// ==========================================
+void testLockFreeSubmitQueue() {
+    std::cout << "\n=== 💍 无锁提交队列测试 ===" << std::endl;
+    std::cout << "目标：16个外部生产者经无锁环形队列提交，环满时退回互斥队列，任务不丢不重" << std::endl;
+
+    // 队列本身：4 生产者 4 消费者，每个值恰好被取出一次
+    const size_t ITEMS = 400000;
+    MpmcQueue<size_t> ring(1024);
+    std::vector<std::atomic<unsigned char>> seen(ITEMS);
+    for (auto& s : seen) { s.store(0); }
+    std::atomic<size_t> consumed(0);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < 4; ++p) {
+        threads.emplace_back([&ring, p]() {
+            for (size_t i = p; i < ITEMS; i += 4) {
+                size_t v = i;
+                while (!ring.try_push(std::move(v))) { std::this_thread::yield(); }
+            }
+        });
+        threads.emplace_back([&ring, &seen, &consumed]() {
+            size_t v;
+            while (consumed.load() < ITEMS) {
+                if (ring.try_pop(v)) {
+                    seen[v]++;
+                    consumed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) { t.join(); }
+    bool queue_ok = ring.empty_approx();
+    for (auto& s : seen) { queue_ok = queue_ok && s.load() == 1; }
+
+    // 线程池：环只有 64 个槽，洪峰期间大部分提交会退回互斥队列
+    ThreadPoolOptions options;
+    options.min_threads = 4;
+    options.max_threads = 4;
+    options.min_stable_time = std::chrono::milliseconds(500);
+    options.submit_queue = SubmitQueue::lock_free;
+    options.submit_ring_capacity = 64;
+    ThreadPool pool(options);
+
+    const int PRODUCERS = 16;
+    const int PER_PRODUCER = 20000;
+    std::atomic<int> done(0);
+    std::vector<Future<int>> futures[PRODUCERS];
+    std::vector<std::thread> producers;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&pool, &done, &futures, p]() {
+            futures[p].reserve(PER_PRODUCER);
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                futures[p].push_back(pool.submit([&done, i]() { done++; return i; }));
+            }
+        });
+    }
+    for (auto& t : producers) { t.join(); }
+    bool pool_ok = true;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        for (int i = 0; i < PER_PRODUCER; ++i) {
+            pool_ok = pool_ok && futures[p][i].get() == i;
+        }
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    pool_ok = pool_ok && done == PRODUCERS * PER_PRODUCER;
+
+    std::cout << "✓ 无锁提交队列测试完成" << std::endl;
+    std::cout << "  MpmcQueue 正确性: " << (queue_ok ? "通过" : "失败")
+              << " | 线程池 " << PRODUCERS * PER_PRODUCER << " 个任务: " << (pool_ok ? "通过" : "失败")
+              << "，耗时 " << duration.count() << " ms" << std::endl;
+    assert(queue_ok && pool_ok);
+}
+
+// ==========================================
+// 测试13：空闲策略与唤醒延迟测试
+// ==========================================
+void testIdleParking() {
+    std::cout << "\n=== 💤 空闲停车与唤醒延迟测试 ===" << std::endl;
+    std::cout << "目标：间歇性微秒级任务的提交到开始延迟，以及真正空闲时所有线程都挂起" << std::endl;
+
+    ThreadPool pool(4, 4, std::chrono::milliseconds(500));
+    const int BURSTS = 2000;
+
+    auto wait_all_parked = [&pool]() {
+        for (int i = 0; i < 1000 && pool.get_idle_count_safe() < 4; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return pool.get_idle_count_safe() == 4;
+    };
+    bool parked_before = wait_all_parked();
+
+    std::vector<long long> latencies;
+    latencies.reserve(BURSTS);
+    for (int i = 0; i < BURSTS; ++i) {
+        auto submitted = std::chrono::steady_clock::now();
+        long long latency = pool.submit([submitted]() {
+            return static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - submitted).count());
+        }).get();
+        latencies.push_back(latency);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    std::sort(latencies.begin(), latencies.end());
+    long long total = 0;
+    for (long long l : latencies) { total += l; }
+
+    bool parked_after = wait_all_parked();
+
+    std::cout << "✓ 空闲停车测试完成" << std::endl;
+    std::cout << "  提交到开始: 平均 " << total / BURSTS / 1000.0 << " μs | p50 " << latencies[BURSTS / 2] / 1000.0
+              << " μs | p99 " << latencies[BURSTS * 99 / 100] / 1000.0 << " μs" << std::endl;
+    std::cout << "  空闲时全部挂起: " << (parked_before && parked_after ? "通过" : "失败") << std::endl;
+    assert(parked_before && parked_after);
+}
+
+// ==========================================
+// 测试14：工作线程控制块与退休测试
+// ==========================================
+void testWorkerRetirement() {
+    std::cout << "\n=== 🪪 工作线程控制块与退休测试 ===" << std::endl;
+    std::cout << "目标：缩容只标记并唤醒目标线程，不等待正在执行长任务的线程" << std::endl;
+
+    ThreadPoolOptions options;
+    options.min_threads = 2;
+    options.max_threads = 8;
+    options.min_stable_time = std::chrono::milliseconds(100);
+    options.scale_interval = std::chrono::milliseconds(5);
+    ThreadPool pool(options);
+
+    // 先把线程池撑到最大
+    std::vector<Future<void>> futures;
+    for (int i = 0; i < 4000; ++i) {
+        futures.push_back(pool.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(100)); }));
+    }
+    for (auto& f : futures) { f.get(); }
+    size_t peak = pool.get_thread_count();
+
+    // 一个长任务占住某个线程，控制器照常缩容（即使这个线程被选中退休也不会阻塞控制器）
+    std::atomic<bool> long_done(false);
+    auto long_task = pool.submit([&long_done]() {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        long_done = true;
+    });
+    auto start = std::chrono::high_resolution_clock::now();
+    while (pool.get_thread_count() > 2 && !long_done.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto shrink_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    bool shrunk_while_busy = !long_done.load() && pool.get_thread_count() == 2;
+    long_task.get();
+
+    std::vector<WorkerInfo> info = pool.get_worker_info();
+    uint64_t executed = 0;
+    bool states_ok = info.size() == 2;
+    for (const WorkerInfo& w : info) {
+        executed += w.tasks_executed;
+        states_ok = states_ok && w.status != ThreadStatus::stopped;
+    }
+
+    std::cout << "✓ 退休测试完成" << std::endl;
+    std::cout << "  峰值线程数: " << peak << " | 长任务运行期间 " << shrink_ms << " ms 缩回 2 个线程: "
+              << (shrunk_while_busy ? "通过" : "失败") << std::endl;
+    std::cout << "  在岗线程执行任务数: " << executed << " | 状态快照: " << (states_ok ? "通过" : "失败") << std::endl;
+    assert(peak > 2 && shrunk_while_busy && states_ok);
+}
+
+// ==========================================
+// 测试15：线程池启动速度测试
+// ==========================================
+void testFastStartup() {
+    std::cout << "\n=== 🚀 线程池启动速度测试 ===" << std::endl;
+    std::cout << "目标：三种启动模式下构造耗时与第一个任务的开始延迟" << std::endl;
+
+    const int ROUNDS = 20;
+    const StartMode modes[] = { StartMode::eager, StartMode::lazy, StartMode::prewarmed };
+    const char* names[] = { "eager", "lazy", "prewarmed" };
+    long long construct_us[3] = { 0, 0, 0 };
+    long long first_task_us[3] = { 0, 0, 0 };
+    bool all_ran = true;
+
+    for (int m = 0; m < 3; ++m) {
+        for (int r = 0; r < ROUNDS; ++r) {
+            ThreadPoolOptions options;
+            options.min_threads = 8;
+            options.max_threads = 8;
+            options.start_mode = modes[m];
+
+            auto start = std::chrono::high_resolution_clock::now();
+            ThreadPool pool(options);
+            auto constructed = std::chrono::high_resolution_clock::now();
+            all_ran = all_ran && pool.submit([]() { return 1; }).get() == 1;
+            auto first_done = std::chrono::high_resolution_clock::now();
+
+            construct_us[m] += std::chrono::duration_cast<std::chrono::microseconds>(constructed - start).count();
+            first_task_us[m] += std::chrono::duration_cast<std::chrono::microseconds>(first_done - constructed).count();
+            if (modes[m] == StartMode::lazy) {
+                all_ran = all_ran && pool.get_thread_count() == 8;
+            }
+        }
+    }
+
+    std::cout << "✓ 启动速度测试完成" << std::endl;
+    for (int m = 0; m < 3; ++m) {
+        std::cout << "  " << names[m] << ": 构造 " << construct_us[m] / ROUNDS << " μs | 第一个任务 "
+                  << first_task_us[m] / ROUNDS << " μs" << std::endl;
+    }
+    // 原实现构造函数固定睡眠 50 ms
+    assert(all_ran && construct_us[0] / ROUNDS < 50000);
+}
+
+// ==========================================
+// 测试16：事件接收者测试
+// ==========================================
+// 记录所有事件；每个事件故意耗时 1 ms，模拟慢速日志
+class RecordingEventSink : public PoolEventSink {
+public:
+    void on_event(const PoolEvent& event) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 拒绝/丢弃事件按周期合并，累加其中的数量；其他事件按次数计
+        bool merged = event.type == PoolEventType::tasks_rejected || event.type == PoolEventType::tasks_discarded;
+        counts_[static_cast<size_t>(event.type)] += merged ? event.count : 1;
+    }
+    size_t count(PoolEventType type) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return counts_[static_cast<size_t>(type)];
+    }
+private:
+    std::mutex mutex_;
+    size_t counts_[6] = { 0, 0, 0, 0, 0, 0 };
+};
+
+void testEventSink() {
+    std::cout << "\n=== 📣 事件接收者测试 ===" << std::endl;
+    std::cout << "目标：慢速事件接收者不拖慢提交方，生命周期事件完整送达" << std::endl;
+
+    auto sink = std::make_shared<RecordingEventSink>();
+    const int REJECTS = 20000;
+    std::chrono::microseconds::rep reject_us = 0;
+    size_t dropped = 0;
+    size_t total_rejects = 0;
+    bool all_rejected = false;
+    {
+        ThreadPoolOptions options;
+        options.min_threads = 2;
+        options.max_threads = 4;
+        options.min_stable_time = std::chrono::milliseconds(50);
+        options.scale_up_backlog = 1;
+        options.queue_capacity = 8;
+        options.rejection_policy = RejectionPolicy::throw_exception;
+        options.event_sink = sink;
+        ThreadPool pool(options);
+
+        // 6 个闸门任务：2 个占住初始线程，4 个排队促使控制器扩容到 4 个线程
+        std::atomic<bool> gate(false);
+        std::atomic<int> started(0);
+        for (int i = 0; i < 6; ++i) {
+            pool.post([&gate, &started]() {
+                started++;
+                while (!gate.load()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+            });
+        }
+        for (int i = 0; i < 2000 && started.load() < 4; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // 把队列填满
+        while (pool.try_submit([]() {}).valid()) {
+        }
+        size_t rejected_before = pool.get_rejected_count();
+
+        // 拒绝只累加计数，由控制器按周期合并成事件投递；接收者再慢也不影响提交方
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < REJECTS; ++i) {
+            pool.try_submit([]() {});
+        }
+        reject_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        gate = true;
+        total_rejects = pool.get_rejected_count();
+        all_rejected = total_rejects - rejected_before == static_cast<size_t>(REJECTS);
+        dropped = pool.get_dropped_event_count();
+    }
+
+    size_t delivered_rejects = sink->count(PoolEventType::tasks_rejected);
+    bool lifecycle_ok = sink->count(PoolEventType::started) == 1 &&
+                        sink->count(PoolEventType::threads_spawned) >= 1 &&
+                        sink->count(PoolEventType::shutdown) == 1;
+    bool rejects_ok = all_rejected && delivered_rejects == total_rejects && dropped == 0;
+
+    std::cout << "✓ 事件接收者测试完成" << std::endl;
+    std::cout << "  " << REJECTS << " 次被拒绝的提交耗时 " << reject_us << " μs（平均 "
+              << static_cast<double>(reject_us) / REJECTS << " μs）" << std::endl;
+    std::cout << "  拒绝数送达 " << delivered_rejects << "/" << total_rejects << " | 丢弃事件 " << dropped
+              << " | 生命周期事件: " << (lifecycle_ok ? "通过" : "失败") << std::endl;
+    // 每次拒绝同步投递一个事件时需要 20 秒以上
+    assert(lifecycle_ok && rejects_ok && reject_us < 2000000);
+}
+
+// ==========================================
+// 测试17：运行指标快照测试
+// ==========================================
+void testMetricsSnapshot() {
+    std::cout << "\n=== 📊 运行指标快照测试 ===" << std::endl;
+    std::cout << "目标：各工作线程的计数与提交数一致，窃取/唤醒被记录，采集快照不拖慢线程池" << std::endl;
+
+    ThreadPool pool(4, 4, std::chrono::milliseconds(500));
+    const int CHILDREN = 200;
+    const int FLOOD = 100000;
+
+    // 等所有线程挂起，之后的提交必然产生唤醒
+    for (int i = 0; i < 1000 && pool.get_idle_count_safe() < 4; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 工作线程内部提交的子任务进入自己的本地队列，其他线程只能窃取
+    std::vector<Future<void>> children;
+    pool.submit([&pool, &children]() {
+        for (int i = 0; i < CHILDREN; ++i) {
+            children.push_back(pool.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds(200)); }));
+        }
+    }).get();
+    for (auto& f : children) { f.get(); }
+
+    // 洪峰期间另一个线程不停采集快照
+    std::atomic<bool> flooding(true);
+    size_t snapshots = 0;
+    std::chrono::nanoseconds::rep snapshot_ns = 0;
+    std::thread scraper([&]() {
+        while (flooding.load()) {
+            auto start = std::chrono::steady_clock::now();
+            PoolStats s = pool.stats();
+            snapshot_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            snapshots += s.threads > 0 ? 1 : 0;
+        }
+    });
+    std::atomic<int> done(0);
+    for (int i = 0; i < FLOOD; ++i) {
+        pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < FLOOD) { std::this_thread::yield(); }
+    flooding = false;
+    scraper.join();
+
+    // 计数在任务返回后才累加，等它追上
+    const uint64_t expected = 1 + CHILDREN + FLOOD;
+    PoolStats stats = pool.stats();
+    for (int i = 0; i < 1000 && stats.tasks_executed < expected; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = pool.stats();
+    }
+    uint64_t per_worker_sum = 0;
+    for (const WorkerStats& w : stats.workers) { per_worker_sum += w.tasks_executed; }
+
+    std::string text = to_prometheus(stats, "test");
+    bool text_ok = text.find("# TYPE threadpool_worker_tasks_executed_total counter") != std::string::npos &&
+                   text.find("threadpool_threads{pool=\"test\"} 4") != std::string::npos &&
+                   text.find("threadpool_worker_steals_total{pool=\"test\",worker=\"0\"}") != std::string::npos;
+
+    bool counts_ok = stats.threads == 4 && stats.workers.size() == 4 &&
+                     stats.tasks_executed == expected && per_worker_sum == expected;
+    bool activity_ok = stats.steals > 0 && stats.wakeups > 0 && stats.busy_ns > 0 && stats.idle_ns > 0;
+
+    std::cout << "✓ 指标快照测试完成" << std::endl;
+    std::cout << "  执行任务: " << stats.tasks_executed << "/" << expected << " | 窃取: " << stats.steals
+              << " | 唤醒: " << stats.wakeups << "（空唤醒 " << stats.spurious_wakeups << "）" << std::endl;
+    std::cout << "  忙碌 " << stats.busy_ns / 1000000 << " ms | 空闲 " << stats.idle_ns / 1000000 << " ms"
+              << " | 洪峰期间快照 " << snapshots << " 次，平均 "
+              << (snapshots ? snapshot_ns / static_cast<std::chrono::nanoseconds::rep>(snapshots) : 0) << " ns" << std::endl;
+    std::cout << "  Prometheus 文本 " << text.size() << " 字节: " << (text_ok ? "通过" : "失败") << std::endl;
+    assert(counts_ok && activity_ok && text_ok);
+}
+
+// ==========================================
+// 测试18：延迟直方图测试
+// ==========================================
+void testLatencyHistograms() {
+    std::cout << "\n=== ⏱️ 延迟直方图测试 ===" << std::endl;
+    std::cout << "目标：分桶误差在 7% 以内，排队时间与执行时间的分位数与实际负载吻合" << std::endl;
+
+    // 分桶精度：每个值都落在报告上界的 1/16 以内
+    bool buckets_ok = true;
+    LatencyHistogram exact;
+    for (uint64_t v = 1; v < (uint64_t(1) << 36); v = v * 3 / 2 + 1) {
+        uint64_t upper = LatencyHistogram::bucket_upper(LatencyHistogram::bucket_index(v));
+        buckets_ok = buckets_ok && upper >= v && upper - v <= v / 16;
+    }
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        exact.record(v * 1000);
+    }
+    buckets_ok = buckets_ok && exact.count() == 1000 &&
+                 exact.p50() >= 500000 && exact.p50() <= 500000 * 17 / 16 &&
+                 exact.p999() >= 999000 && exact.p999() <= 1000000;
+
+    // 2 个线程、每个任务 1 ms，一次提交 40 个：执行时间约 1 ms，排在最后的任务等待约 19 ms
+    ThreadPoolOptions options;
+    options.min_threads = 2;
+    options.max_threads = 2;
+    options.latency_histograms = true;
+    ThreadPool pool(options);
+    const int TASKS = 40;
+    std::vector<Future<void>> futures;
+    for (int i = 0; i < TASKS; ++i) {
+        futures.push_back(pool.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }));
+    }
+    for (auto& f : futures) { f.get(); }
+    LatencyStats latency = pool.latency();
+    for (int i = 0; i < 1000 && latency.execution.count() < static_cast<uint64_t>(TASKS); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        latency = pool.latency();
+    }
+
+    bool pool_ok = latency.queue_wait.count() == static_cast<uint64_t>(TASKS) &&
+                   latency.execution.count() == static_cast<uint64_t>(TASKS) &&
+                   latency.execution.p50() >= 1000000 &&
+                   latency.queue_wait.max() >= 15000000 &&
+                   latency.queue_wait.p50() < latency.queue_wait.max();
+    bool disabled_ok = ThreadPool(1, 1).latency().execution.count() == 0;
+
+    std::cout << "✓ 延迟直方图测试完成" << std::endl;
+    std::cout << "  分桶精度: " << (buckets_ok ? "通过" : "失败") << std::endl;
+    std::cout << "  排队时间: p50 " << latency.queue_wait.p50() / 1000 << " μs | p99 " << latency.queue_wait.p99() / 1000
+              << " μs | 最大 " << latency.queue_wait.max() / 1000 << " μs" << std::endl;
+    std::cout << "  执行时间: p50 " << latency.execution.p50() / 1000 << " μs | p99.9 " << latency.execution.p999() / 1000
+              << " μs | 平均 " << latency.execution.mean() / 1000 << " μs" << std::endl;
+    assert(buckets_ok && pool_ok && disabled_ok);
+}
+
+// ==========================================
+// 测试19：执行追踪导出测试
+// ==========================================
+// 同样的小任务洪峰，返回每秒完成的任务数
+double floodThroughput(size_t trace_events) {
+    ThreadPoolOptions options;
+    options.min_threads = 2;
+    options.max_threads = 2;
+    options.trace_buffer_events = trace_events;
+    ThreadPool pool(options);
+    const int TASKS = 100000;
+    std::atomic<int> done(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TASKS; ++i) {
+        pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < TASKS) { std::this_thread::yield(); }
+    auto seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return TASKS / seconds;
+}
+
+void testTraceExport() {
+    std::cout << "\n=== 🧭 执行追踪导出测试 ===" << std::endl;
+    std::cout << "目标：突发负载下记录任务区间、挂起区间和扩缩容，导出 Chrome Trace JSON，并报告追踪带来的每任务开销" << std::endl;
+
+    ThreadPoolOptions options;
+    options.min_threads = 2;
+    options.max_threads = 4;
+    options.scale_interval = std::chrono::milliseconds(5);
+    options.scale_up_backlog = 1;
+    options.trace_buffer_events = 1 << 16;
+    ThreadPool pool(options);
+
+    const int BURST_SIZE = 5000;
+    const int BURST_COUNT = 2;
+    for (int burst = 0; burst < BURST_COUNT; ++burst) {
+        std::vector<Future<void>> futures;
+        futures.reserve(BURST_SIZE);
+        for (int i = 0; i < BURST_SIZE; ++i) {
+            futures.push_back(pool.submit([i]() {
+                if (i % 2 == 0) {
+                    ThreadPool::trace_label("resize \"even\"");
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }));
+        }
+        for (auto& f : futures) { f.get(); }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::ostringstream json;
+    pool.write_trace(json);
+    std::string text = json.str();
+    auto count = [&text](const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) { ++n; }
+        return n;
+    };
+    size_t tasks = count("\"cat\":\"task\"");
+    size_t labelled = count("resize \\\"even\\\"");
+    bool json_ok = text.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0 &&
+                   text.compare(text.size() - 4, 4, "\n]}\n") == 0 &&
+                   count("{") == count("}") && count("[") == count("]");
+    bool content_ok = tasks == static_cast<size_t>(BURST_SIZE * BURST_COUNT) &&
+                      labelled == static_cast<size_t>(BURST_SIZE * BURST_COUNT / 2) &&
+                      count("\"name\":\"parked\"") > 0 && count("\"name\":\"scale_up\"") > 0 &&
+                      count("\"name\":\"thread_name\"") >= 3 && pool.get_dropped_trace_count() == 0;
+
+    // 追踪开销：空任务洪峰是最坏情况，每个任务多出的时间主要是三次读时钟
+    double plain = floodThroughput(0);
+    double traced = floodThroughput(1 << 17);
+    double overhead_ns = (1.0 / traced - 1.0 / plain) * 1e9;
+
+    std::cout << "✓ 追踪导出测试完成" << std::endl;
+    std::cout << "  JSON " << text.size() / 1024 << " KB | 任务区间 " << tasks << "（带标签 " << labelled
+              << "）| 挂起区间 " << count("\"name\":\"parked\"") << " | 扩容 " << count("\"name\":\"scale_up\"")
+              << " | 格式: " << (json_ok ? "通过" : "失败") << std::endl;
+    std::cout << "  微任务吞吐: 未追踪 " << static_cast<long>(plain) << " tasks/sec | 追踪 "
+              << static_cast<long>(traced) << " tasks/sec | 每任务开销 " << static_cast<long>(overhead_ns) << " ns" << std::endl;
+    assert(json_ok && content_ok);
+}
+
+// ==========================================
+// 测试20：绑核与 NUMA 测试
+// ==========================================
+// 在临时目录中按 sysfs 布局构造双路机器：每路一个节点、2 个物理核、每核 2 个超线程
+std::string makeFakeSysfs() {
+    std::string root = "/tmp/threadpool_sysfs_" + std::to_string(::getpid());
+    auto write = [&root](const std::string& path, const std::string& text) {
+        std::string full = root + "/" + path;
+        std::system(("mkdir -p " + full.substr(0, full.rfind('/'))).c_str());
+        std::ofstream(full.c_str()) << text << "\n";
+    };
+    write("cpu/online", "0-7");
+    write("node/online", "0-1");
+    write("node/node0/cpulist", "0-3");
+    write("node/node1/cpulist", "4-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        std::string dir = "cpu/cpu" + std::to_string(cpu) + "/topology/";
+        write(dir + "core_id", std::to_string(cpu % 2));
+        write(dir + "physical_package_id", std::to_string(cpu / 4));
+    }
+    return root;
+}
+
+void testAffinityAndNuma() {
+    std::cout << "\n=== 🧬 绑核与 NUMA 测试 ===" << std::endl;
+    std::cout << "目标：拓扑解析与三种绑核方案正确，工作线程真的跑在指定 CPU 上，节点队列的任务都能完成" << std::endl;
+
+    // 拓扑与绑核方案
+    std::string root = makeFakeSysfs();
+    threadpool_detail::CpuTopology topology = threadpool_detail::load_topology(root);
+    std::system(("rm -rf " + root).c_str());
+    std::vector<int> compact = threadpool_detail::plan_affinity(topology, AffinityPolicy::compact, {}, 4);
+    std::vector<int> scatter = threadpool_detail::plan_affinity(topology, AffinityPolicy::scatter, {}, 4);
+    std::vector<int> listed = threadpool_detail::plan_affinity(topology, AffinityPolicy::explicit_cpus, {3, 5}, 3);
+    bool topology_ok = topology.nodes == 2 && topology.cpus.size() == 8 &&
+                       topology.node_of(5) == 1 && topology.node_of(2) == 0;
+    bool plans_ok = compact == std::vector<int>({0, 2, 1, 3}) &&     // 先占满节点 0，同核超线程相邻
+                    scatter == std::vector<int>({0, 4, 1, 5}) &&     // 节点间轮流，节点内先分散到不同物理核
+                    listed == std::vector<int>({3, 5, 3});
+
+    // 本机实际绑核：任务里读到的 CPU 必须是所在线程绑定的 CPU
+    ThreadPoolOptions options;
+    options.min_threads = 4;
+    options.max_threads = 4;
+    options.affinity = AffinityPolicy::scatter;
+    options.numa_local_submit = true;
+    options.start_mode = StartMode::prewarmed;
+    ThreadPool pool(options);
+    std::vector<WorkerInfo> info = pool.get_worker_info();
+    std::map<std::thread::id, int> pinned;
+    for (const WorkerInfo& w : info) { pinned[w.id] = w.cpu; }
+    std::atomic<int> mismatched(0);
+    const int TASKS = 4000;
+    std::vector<Future<void>> futures;
+    for (int i = 0; i < TASKS; ++i) {
+        auto check = [&pinned, &mismatched]() {
+            if (pinned.at(std::this_thread::get_id()) != threadpool_detail::current_cpu()) {
+                mismatched++;
+            }
+        };
+        if (i % 2 == 0) {
+            futures.push_back(pool.submit_on_node(static_cast<size_t>(i), check));
+        } else {
+            futures.push_back(pool.submit(check));
+        }
+    }
+    for (auto& f : futures) { f.get(); }
+    bool pinned_ok = info.size() == 4 && mismatched.load() == 0;
+    for (const WorkerInfo& w : info) {
+        pinned_ok = pinned_ok && w.cpu >= 0 && w.node < pool.numa_node_count();
+    }
+
+    std::cout << "✓ 绑核与 NUMA 测试完成" << std::endl;
+    std::cout << "  模拟拓扑: " << (topology_ok ? "通过" : "失败") << " | compact/scatter/explicit 方案: "
+              << (plans_ok ? "通过" : "失败") << std::endl;
+    std::cout << "  本机 " << pool.numa_node_count() << " 个 NUMA 节点 | 绑核线程 CPU:";
+    for (const WorkerInfo& w : info) { std::cout << " " << w.cpu; }
+    std::cout << " | " << TASKS << " 个任务运行在绑定 CPU 上: " << (pinned_ok ? "通过" : "失败") << std::endl;
+    assert(topology_ok && plans_ok && pinned_ok);
+}
+
+// ==========================================
+// 测试21：任务图测试
+// ==========================================
+// 只可移动的节点：std::function 无法存放
+struct MoveOnlyStage {
+    std::unique_ptr<int> value;
+    std::atomic<int>* sum;
+    void operator()() { sum->fetch_add(*value); }
+};
+
+void testTaskGraph() {
+    std::cout << "\n=== 🕸️ 任务图测试 ===" << std::endl;
+    std::cout << "目标：依赖由计数驱动、没有线程阻塞等待；单线程池也能跑完菱形依赖，图可重复运行" << std::endl;
+
+    // 单线程池上的菱形依赖：若在任务里 get() 前驱的 Future 会直接死锁
+    ThreadPool single(1, 1);
+    std::vector<int> order;
+    TaskGraph diamond;
+    TaskGraph::TaskNode a = diamond.emplace([&order]() { order.push_back(0); });
+    TaskGraph::TaskNode b = diamond.emplace([&order]() { order.push_back(1); });
+    TaskGraph::TaskNode c = diamond.emplace([&order]() { order.push_back(2); });
+    TaskGraph::TaskNode d = diamond.emplace([&order]() { order.push_back(3); });
+    a.precede(b).precede(c);
+    d.succeed(b).succeed(c);
+    diamond.run(single).get();
+    bool diamond_ok = order.size() == 4 && order.front() == 0 && order.back() == 3;
+
+    // 4 条流水线各 1000 级，每 100 级相互汇合一次；每个节点记下完成序号，检查每条边都先后有序
+    const int LANES = 4;
+    const int STAGES = 1000;
+    const int RUNS = 20;
+    ThreadPool pool(4, 4);
+    TaskGraph pipeline;
+    std::atomic<int> clock(0);
+    std::vector<int> stamp(LANES * STAGES);
+    std::vector<std::pair<int, int>> edges;
+    std::vector<TaskGraph::TaskNode> nodes;
+    for (int lane = 0; lane < LANES; ++lane) {
+        for (int stage = 0; stage < STAGES; ++stage) {
+            int id = lane * STAGES + stage;
+            nodes.push_back(pipeline.emplace([&stamp, &clock, id]() { stamp[id] = clock++; }));
+        }
+    }
+    for (int lane = 0; lane < LANES; ++lane) {
+        for (int stage = 1; stage < STAGES; ++stage) {
+            int id = lane * STAGES + stage;
+            nodes[id - 1].precede(nodes[id]);
+            edges.push_back(std::make_pair(id - 1, id));
+            if (stage % 100 == 0) {
+                int other = ((lane + 1) % LANES) * STAGES + stage - 1;
+                nodes[other].precede(nodes[id]);
+                edges.push_back(std::make_pair(other, id));
+            }
+        }
+    }
+    bool order_ok = true;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < RUNS; ++run) {
+        pipeline.run(pool).get();
+        for (const auto& e : edges) {
+            order_ok = order_ok && stamp[e.first] < stamp[e.second];
+        }
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    bool pipeline_ok = order_ok && clock.load() == LANES * STAGES * RUNS;
+
+    // 异常：后续节点跳过，Future 携带异常；之后图仍可再次运行
+    TaskGraph failing;
+    std::atomic<int> ran(0);
+    TaskGraph::TaskNode boom = failing.emplace([]() { throw std::runtime_error("stage failed"); });
+    TaskGraph::TaskNode after = failing.emplace([&ran]() { ran++; });
+    boom.precede(after);
+    bool threw = false;
+    try { failing.run(pool).get(); } catch (const std::runtime_error&) { threw = true; }
+    bool error_ok = threw && ran.load() == 0;
+
+    // 运行途中线程池停止：入队失败的后继被跳过，Future 带着异常就绪，图可以在别的线程池上再次运行
+    TaskGraph interrupted;
+    std::atomic<bool> started(false);
+    std::atomic<int> skipped_ran(0);
+    TaskGraph::TaskNode head = interrupted.emplace([&started]() {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    });
+    for (int i = 0; i < 3; ++i) {
+        head.precede(interrupted.emplace([&skipped_ran]() { skipped_ran++; }));
+    }
+    bool stop_ok = false;
+    {
+        std::unique_ptr<ThreadPool> doomed(new ThreadPool(1, 1));
+        Future<void> run = interrupted.run(*doomed);
+        while (!started.load()) {
+            std::this_thread::yield();
+        }
+        doomed.reset();
+        try { run.get(); } catch (const std::runtime_error&) { stop_ok = skipped_ran.load() == 0; }
+    }
+    skipped_ran = 0;
+    interrupted.run(pool).get();
+    stop_ok = stop_ok && skipped_ran.load() == 3;
+
+    // 只可移动的节点，每次运行都执行同一个闭包
+    TaskGraph move_only;
+    std::atomic<int> moved_sum(0);
+    move_only.emplace(MoveOnlyStage{std::unique_ptr<int>(new int(7)), &moved_sum});
+    move_only.run(pool).get();
+    move_only.run(pool).get();
+    bool move_only_ok = moved_sum.load() == 14;
+
+    // 环
+    TaskGraph cyclic;
+    TaskGraph::TaskNode x = cyclic.emplace([]() {});
+    TaskGraph::TaskNode y = cyclic.emplace([]() {});
+    TaskGraph::TaskNode z = cyclic.emplace([]() {});
+    x.precede(y);
+    y.precede(z);
+    z.precede(y);
+    bool cycle_rejected = false;
+    try { cyclic.run(pool); } catch (const std::invalid_argument&) { cycle_rejected = true; }
+
+    std::cout << "✓ 任务图测试完成" << std::endl;
+    std::cout << "  单线程菱形依赖: " << (diamond_ok ? "通过" : "失败") << " | 异常传播: " << (error_ok ? "通过" : "失败")
+              << " | 运行中停止线程池: " << (stop_ok ? "通过" : "失败") << " | 只可移动节点: " << (move_only_ok ? "通过" : "失败")
+              << " | 环检测: " << (cycle_rejected ? "通过" : "失败") << std::endl;
+    std::cout << "  " << LANES * STAGES << " 个节点的流水线运行 " << RUNS << " 次，平均 " << duration.count() / RUNS
+              << " μs/次（" << duration.count() * 1000 / (RUNS * LANES * STAGES) << " ns/节点），依赖顺序: "
+              << (pipeline_ok ? "通过" : "失败") << std::endl;
+    assert(diamond_ok && pipeline_ok && error_ok && stop_ok && move_only_ok && cycle_rejected);
+}
+
+// ==========================================
+// 测试22：非阻塞延续测试
+// ==========================================
+void testContinuations() {
+    std::cout << "\n=== 🔗 非阻塞延续测试 ===" << std::endl;
+    std::cout << "目标：then / when_all / when_any 组合任务时没有线程等待，单线程池上的扇出/扇入也不会死锁" << std::endl;
+
+    ThreadPool pool(2, 2);
+
+    // then 链：前驱的值与异常都传给下一步
+    int chained = pool.submit([]() { return 20; })
+        .then(pool, [](Future<int> r) { return r.get() + 1; })
+        .then(pool, [](Future<int> r) { return r.get() * 2; })
+        .get();
+    bool recovered = pool.submit([]() -> int { throw std::runtime_error("boom"); })
+        .then(pool, [](Future<int> r) {
+            try { r.get(); } catch (const std::runtime_error&) { return true; }
+            return false;
+        })
+        .get();
+    bool then_ok = chained == 42 && recovered;
+
+    // 单线程池：任务内部扇出 100 个子任务，用 when_all + then 汇总后返回，不在任务里等待
+    ThreadPool single(1, 1);
+    const int FANOUT = 100;
+    Future<long> total = single.submit([&single]() {
+        std::vector<Future<long>> parts;
+        for (int i = 1; i <= FANOUT; ++i) {
+            parts.push_back(single.submit([i]() { return static_cast<long>(i); }));
+        }
+        return when_all(std::move(parts)).then(single, [](Future<std::vector<Future<long>>> all) {
+            long sum = 0;
+            for (auto& part : all.get()) { sum += part.get(); }
+            return sum;
+        });
+    }).get();
+    bool fan_in_ok = total.get() == FANOUT * (FANOUT + 1) / 2;
+
+    // 洪峰式扇入：调用方不再逐个 get()，只等一次汇总
+    const int TASKS = 100000;
+    std::vector<Future<int>> futures;
+    futures.reserve(TASKS);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TASKS; ++i) {
+        futures.push_back(pool.submit([i]() { return i % 7; }));
+    }
+    long long expected = 0;
+    for (int i = 0; i < TASKS; ++i) { expected += i % 7; }
+    long long flood_sum = when_all(std::move(futures)).then(pool, [](Future<std::vector<Future<int>>> all) {
+        long long sum = 0;
+        for (auto& f : all.get()) { sum += f.get(); }
+        return sum;
+    }).get();
+    auto flood_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    bool flood_ok = flood_sum == expected;
+
+    // 不同类型的 when_all，以及 when_any 取最快的一个
+    auto mixed = when_all(pool.submit([]() { return 7; }),
+                          pool.submit([]() { return std::string("seven"); }),
+                          pool.submit([]() {})).get();
+    std::get<2>(mixed).get();
+    bool mixed_ok = std::get<0>(mixed).get() == 7 && std::get<1>(mixed).get() == "seven";
+
+    std::vector<Future<int>> racers;
+    racers.push_back(pool.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds(300)); return 0; }));
+    racers.push_back(pool.submit([]() { return 1; }));
+    WhenAnyResult<int> first = when_any(std::move(racers)).get();
+    bool any_ok = first.index == 1 && first.future.get() == 1;
+
+    std::cout << "✓ 非阻塞延续测试完成" << std::endl;
+    std::cout << "  then 链与异常传递: " << (then_ok ? "通过" : "失败") << " | 单线程池扇出/扇入: "
+              << (fan_in_ok ? "通过" : "失败") << " | 混合类型 when_all: " << (mixed_ok ? "通过" : "失败")
+              << " | when_any: " << (any_ok ? "通过" : "失败") << std::endl;
+    std::cout << "  " << TASKS << " 个任务用 when_all 汇总，耗时 " << flood_ms << " ms: " << (flood_ok ? "通过" : "失败") << std::endl;
+    assert(then_ok && fan_in_ok && flood_ok && mixed_ok && any_ok);
+}
+
+// ==========================================
+// 测试23：任务组与等待时代为执行
+// ==========================================
+static long groupFib(ThreadPool& pool, int n) {
+    if (n < 16) {
+        return n < 2 ? n : groupFib(pool, n - 1) + groupFib(pool, n - 2);
+    }
+    long a = 0;
+    TaskGroup group(pool);
+    group.run([&pool, &a, n]() { a = groupFib(pool, n - 1); });
+    long b = groupFib(pool, n - 2);
+    group.wait();
+    return a + b;
+}
+
+// 每层只剩一个子任务在等：嵌套深度远超线程数
+static int nestedDepth(ThreadPool& pool, int depth) {
+    if (depth == 0) {
+        return 0;
+    }
+    int child = 0;
+    TaskGroup group(pool);
+    group.run([&pool, &child, depth]() { child = nestedDepth(pool, depth - 1); });
+    group.wait();
+    return child + 1;
+}
+
+void testTaskGroup() {
+    std::cout << "\n=== 🤝 任务组测试 ===" << std::endl;
+    std::cout << "目标：工作线程里 wait() 时代为执行其他任务，满员线程池上的嵌套 fork-join 不会死锁" << std::endl;
+
+    // 线程数已到上限：若在任务里用 future.get() 等待子任务，两层嵌套就会占满全部线程
+    ThreadPool pool(2, 2);
+    auto start = std::chrono::high_resolution_clock::now();
+    long fib = pool.submit([&pool]() { return groupFib(pool, 30); }).get();
+    auto fib_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    const int DEPTH = 200;
+    int depth = pool.submit([&pool]() { return nestedDepth(pool, DEPTH); }).get();
+    bool nested_ok = fib == 832040 && depth == DEPTH;
+    PoolStats stats = pool.stats();
+    size_t active_workers = 0;
+    for (const WorkerStats& w : stats.workers) {
+        if (w.tasks_executed > 0) {
+            ++active_workers;
+        }
+    }
+
+    // 外部线程等待：挂起直到计数归零
+    const int TASKS = 10000;
+    std::atomic<int> done(0);
+    TaskGroup group(pool);
+    for (int i = 0; i < TASKS; ++i) {
+        group.run([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    group.wait();
+    bool external_ok = done.load() == TASKS && group.pending() == 0;
+
+    // 异常：wait() 抛出第一个异常，之后任务组可以继续使用
+    bool caught = false;
+    group.run([]() { throw std::runtime_error("group failure"); });
+    try {
+        group.wait();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    group.run([&done]() { done.fetch_add(1); });
+    group.wait();
+    bool error_ok = caught && done.load() == TASKS + 1;
+
+    std::cout << "✓ 任务组测试完成" << std::endl;
+    std::cout << "  2 线程满员池 fib(30) = " << fib << "，耗时 " << fib_ms << " ms | 嵌套 " << depth
+              << " 层: " << (nested_ok ? "通过" : "失败") << " | 执行过任务的线程: " << active_workers << std::endl;
+    std::cout << "  外部等待 " << TASKS << " 个任务: " << (external_ok ? "通过" : "失败")
+              << " | 异常传递与复用: " << (error_ok ? "通过" : "失败") << std::endl;
+    assert(nested_ok && active_workers >= 1 && external_ok && error_ok);
+}
+
+// ==========================================
+// 测试24：工作线程内存池
+// ==========================================
+// 大于 Task 内联缓冲区的闭包
+struct WideClosure {
+    int values[20];
+    std::atomic<long>* sum;
+    void operator()() { sum->fetch_add(values[0] + values[19], std::memory_order_relaxed); }
+};
+
+void testWorkerArena() {
+    std::cout << "\n=== 🧱 工作线程内存池测试 ===" << std::endl;
+    std::cout << "目标：任务内的临时容器从本线程内存池分配，稳定后不再调用全局 malloc；大闭包的块在线程内回收复用" << std::endl;
+
+    const int TASKS = 20000;
+    ThreadPool pool(4, 4);
+
+    // 与洪峰测试的内存分支相同的负载：每个任务一个 1000 元素的临时数组
+    auto run = [&pool](bool use_arena, std::atomic<size_t>& allocs) {
+        std::atomic<long long> sum(0);
+        std::vector<Future<void>> futures;
+        futures.reserve(TASKS);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < TASKS; ++i) {
+            futures.push_back(pool.submit([i, use_arena, &sum, &allocs]() {
+                size_t before = t_alloc_count;
+                long long local = 0;
+                // 两种方式都用 std::fill 填充，只比较分配本身（任务结束时内存池自动回退，无需释放）
+                if (use_arena) {
+                    int* data = static_cast<int*>(ThreadPool::local_arena()->allocate(1000 * sizeof(int), alignof(int)));
+                    std::fill(data, data + 1000, i);
+                    local = data[0] + data[999];
+                } else {
+                    std::unique_ptr<int[]> data(new int[1000]);
+                    std::fill(data.get(), data.get() + 1000, i);
+                    local = data[0] + data[999];
+                }
+                allocs.fetch_add(t_alloc_count - before, std::memory_order_relaxed);
+                sum.fetch_add(local, std::memory_order_relaxed);
+            }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        long long expected = static_cast<long long>(TASKS) * (TASKS - 1);
+        assert(sum.load() == expected);
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    };
+    std::atomic<size_t> heap_allocs(0);
+    std::atomic<size_t> arena_allocs(0);
+    auto heap_ms = run(false, heap_allocs);
+    auto arena_ms = run(true, arena_allocs);
+    bool arena_ok = arena_allocs.load() * 100 < static_cast<size_t>(TASKS);
+
+    // 嵌套：外层任务的分配在内层（代为执行的）任务回退后仍然有效
+    bool nested_ok = pool.submit([&pool]() {
+        std::vector<int, ArenaAllocator<int>> outer(4096, 7, ArenaAllocator<int>(ThreadPool::local_arena()));
+        TaskGroup group(pool);
+        for (int i = 0; i < 64; ++i) {
+            group.run([]() {
+                std::vector<int, ArenaAllocator<int>> inner(4096, -1, ArenaAllocator<int>(ThreadPool::local_arena()));
+                (void)inner;
+            });
+        }
+        group.wait();
+        return std::count(outer.begin(), outer.end(), 7) == 4096;
+    }).get();
+    bool outside_ok = ThreadPool::local_arena() == nullptr;
+#if defined(THREADPOOL_HAS_PMR)
+    // C++17 下内存池直接作为 std::pmr::memory_resource 使用
+    bool pmr_ok = pool.submit([]() {
+        std::pmr::vector<int> values(ThreadPool::local_arena());
+        values.assign(100, 3);
+        return std::count(values.begin(), values.end(), 3) == 100;
+    }).get();
+#else
+    bool pmr_ok = true;
+#endif
+
+    // 单线程池里任务反复提交大闭包：块在同一线程内循环使用
+    ThreadPool single(1, 1);
+    const int ROUNDS = 100;
+    const int PER_ROUND = 100;
+    std::atomic<long> wide_sum(0);
+    size_t wide_allocs = single.submit([&single, &wide_sum]() {
+        TaskGroup group(single);
+        WideClosure closure;
+        for (int k = 0; k < 20; ++k) { closure.values[k] = 1; }
+        closure.sum = &wide_sum;
+        group.run(closure);
+        group.wait();
+        size_t before = t_alloc_count;
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (int i = 0; i < PER_ROUND; ++i) {
+                group.run(closure);
+            }
+            group.wait();
+        }
+        return t_alloc_count - before;
+    }).get();
+    bool recycle_ok = wide_sum.load() == 2L * (ROUNDS * PER_ROUND + 1) && wide_allocs * 10 < static_cast<size_t>(ROUNDS * PER_ROUND);
+
+    std::cout << "✓ 工作线程内存池测试完成" << std::endl;
+    std::cout << "  " << TASKS << " 个任务各分配 4KB 临时数组 | 全局堆: " << heap_ms << " ms, " << heap_allocs.load()
+              << " 次分配 | 内存池: " << arena_ms << " ms, " << arena_allocs.load() << " 次分配" << std::endl;
+    std::cout << "  嵌套回退: " << (nested_ok ? "通过" : "失败") << " | 工作线程外为空: " << (outside_ok ? "通过" : "失败")
+              << " | " << ROUNDS * PER_ROUND << " 个大闭包的分配次数: " << wide_allocs << std::endl;
+    assert(arena_ok && nested_ok && outside_ok && pmr_ok && recycle_ok);
+}
+
+// ==========================================
+// 测试25：定时任务（分层时间轮）
+// ==========================================
+void testTimerService() {
+    std::cout << "\n=== ⏰ 定时任务测试 ===" << std::endl;
+    std::cout << "目标：延迟/定点/周期任务不早于指定时间执行，等待期间不占用工作线程；百万级定时器插入与取消为 O(1)" << std::endl;
+
+    ThreadPool pool(1, 1);
+    TimerService timers(pool);
+    typedef std::chrono::steady_clock Clock;
+
+    // 延迟任务按到期顺序执行，且不早于指定时间
+    std::mutex order_mutex;
+    std::vector<int> order;
+    std::atomic<int> early(0);
+    Clock::time_point base = Clock::now();
+    const int delays[] = { 30, 10, 20 };
+    for (int d : delays) {
+        timers.schedule_after(std::chrono::milliseconds(d), [d, base, &order, &order_mutex, &early]() {
+            if (Clock::now() - base < std::chrono::milliseconds(d)) {
+                early++;
+            }
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(d);
+        });
+    }
+    std::atomic<bool> at_fired(false);
+    timers.schedule_at(base + std::chrono::milliseconds(15), [&at_fired]() { at_fired = true; });
+
+    // 单线程池在等待期间仍能立即执行其他任务
+    bool responsive = pool.submit([]() { return 1; }).wait_for(std::chrono::milliseconds(5)) == std::future_status::ready;
+
+    // 取消：成功一次，之后句柄失效
+    std::atomic<bool> canceled_ran(false);
+    TimerId doomed = timers.schedule_after(std::chrono::milliseconds(20), [&canceled_ran]() { canceled_ran = true; });
+    bool cancel_ok = timers.cancel(doomed) && !timers.cancel(doomed);
+
+    // 周期任务：每 5ms 一次，取消后不再执行
+    std::atomic<int> ticks(0);
+    TimerId periodic = timers.schedule_every(std::chrono::milliseconds(5), [&ticks]() { ticks++; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    timers.cancel(periodic);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int ticks_after_cancel = ticks.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    bool periodic_ok = ticks_after_cancel >= 5 && ticks.load() == ticks_after_cancel;
+
+    bool order_ok;
+    {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order_ok = order.size() == 3 && order[0] == 10 && order[1] == 20 && order[2] == 30;
+    }
+    bool basic_ok = order_ok && early.load() == 0 && at_fired && !canceled_ran;
+
+    // 同一时刻到期的一批任务整批投递；300ms 超出第 0 层一圈，需要从上层下放
+    const int BURST = 10000;
+    std::atomic<int> burst_done(0);
+    std::atomic<int> burst_early(0);
+    Clock::time_point burst_at = Clock::now() + std::chrono::milliseconds(300);
+    for (int i = 0; i < BURST; ++i) {
+        timers.schedule_at(burst_at, [burst_at, &burst_done, &burst_early]() {
+            if (Clock::now() < burst_at) {
+                burst_early++;
+            }
+            burst_done++;
+        });
+    }
+    while (burst_done.load() < BURST) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto burst_lag_ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - burst_at).count();
+
+    // 百万级挂起的超时：插入与取消的平均开销
+    const int MANY = 1000000;
+    std::vector<TimerId> ids;
+    ids.reserve(MANY);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> spread(60 * 1000, 3600 * 1000);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < MANY; ++i) {
+        ids.push_back(timers.schedule_after(std::chrono::milliseconds(spread(rng)), []() {}));
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    size_t pending = timers.pending();
+    size_t canceled = 0;
+    for (const TimerId& id : ids) {
+        canceled += timers.cancel(id) ? 1 : 0;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double insert_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() / double(MANY);
+    double cancel_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() / double(MANY);
+    bool many_ok = pending == static_cast<size_t>(MANY) && canceled == static_cast<size_t>(MANY) && timers.pending() == 0;
+
+    std::cout << "✓ 定时任务测试完成" << std::endl;
+    std::cout << "  到期顺序与不提前: " << (basic_ok ? "通过" : "失败") << " | 等待期间线程池可响应: " << (responsive ? "是" : "否")
+              << " | 取消: " << (cancel_ok ? "通过" : "失败") << " | 100ms 内周期执行 " << ticks_after_cancel << " 次，取消后停止: "
+              << (periodic_ok ? "是" : "否") << std::endl;
+    std::cout << "  " << BURST << " 个同时到期的任务在到期后 " << burst_lag_ms << " ms 内全部完成 | " << MANY
+              << " 个定时器: 插入 " << insert_ns << " ns/个，取消 " << cancel_ns << " ns/个" << std::endl;
+    assert(basic_ok && responsive && cancel_ok && periodic_ok && burst_early.load() == 0 && many_ok);
+}
+
+// ==========================================
+// 测试26：资源组加权公平调度
+// ==========================================
+void testResourceGroups() {
+    std::cout << "\n=== ⚖️ 资源组公平调度测试 ===" << std::endl;
+    std::cout << "目标：积压大量任务的租户饿不死其他租户；争用时按权重分配执行时间；并发上限生效，受阻的任务不让空闲线程空转" << std::endl;
+
+    ThreadPool pool(2, 2);
+    std::atomic<bool> stop(false);
+    auto work = [&stop]() {
+        if (!stop.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    auto drain = [&stop](ResourceGroup& group) {
+        stop = true;
+        while (group.stats().queued != 0 || group.stats().running != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        stop = false;
+    };
+
+    // 吵闹的租户先积压 600 个任务，安静的租户随后提交 20 个：按 FIFO 要排在 600 个之后
+    ResourceGroup& noisy = pool.group("noisy");
+    ResourceGroup& quiet = pool.group("quiet");
+    const int NOISY = 600;
+    const int QUIET = 20;
+    for (int i = 0; i < NOISY; ++i) {
+        noisy.post(work);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Future<void>> quiet_done;
+    for (int i = 0; i < QUIET; ++i) {
+        quiet_done.push_back(quiet.submit(work));
+    }
+    for (auto& f : quiet_done) {
+        f.get();
+    }
+    auto quiet_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    uint64_t noisy_before_quiet = noisy.stats().executed;
+    bool starvation_ok = noisy_before_quiet < static_cast<uint64_t>(NOISY / 3);
+    drain(noisy);
+
+    // 两组同时积压，权重 3:1
+    ResourceGroupOptions gold_options;
+    gold_options.weight = 3;
+    ResourceGroup& gold = pool.group("gold", gold_options);
+    ResourceGroup& bronze = pool.group("bronze");
+    for (int i = 0; i < 400; ++i) {
+        gold.post(work);
+        bronze.post(work);
+    }
+    while (gold.stats().executed + bronze.stats().executed < 200) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ResourceGroupStats gold_stats = gold.stats();
+    ResourceGroupStats bronze_stats = bronze.stats();
+    double share = static_cast<double>(gold_stats.busy_ns) / std::max<uint64_t>(bronze_stats.busy_ns, 1);
+    bool weight_ok = share > 2.0 && share < 4.5;
+    drain(gold);
+    drain(bronze);
+
+    // 并发上限 1：同组任务串行执行，另一个线程挂起而不是为排队的任务空转
+    ResourceGroupOptions serial_options;
+    serial_options.max_concurrency = 1;
+    ResourceGroup& serial = pool.group("serial", serial_options);
+    std::atomic<int> running(0);
+    std::atomic<int> max_running(0);
+    std::vector<Future<void>> serial_done;
+    for (int i = 0; i < 4; ++i) {
+        serial_done.push_back(serial.submit([&running, &max_running]() {
+            int now = ++running;
+            int seen = max_running.load();
+            while (now > seen && !max_running.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            --running;
+        }));
+    }
+    // 多次采样：线程刚结束一个任务时可能还在找任务
+    size_t parked = 0;
+    for (int sample = 0; sample < 20 && parked == 0; ++sample) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (const WorkerStats& w : pool.stats().workers) {
+            if (w.status == ThreadStatus::parked) {
+                ++parked;
+            }
+        }
+    }
+    for (auto& f : serial_done) {
+        f.get();
+    }
+    bool cap_ok = max_running.load() == 1 && parked == 1 && serial.stats().executed == 4;
+
+    std::cout << "✓ 资源组公平调度测试完成" << std::endl;
+    std::cout << "  " << NOISY << " 个积压任务之后提交的 " << QUIET << " 个任务 " << quiet_ms << " ms 内完成，期间积压组只执行了 "
+              << noisy_before_quiet << " 个 | 权重 3:1 的执行时间比: " << share << std::endl;
+    std::cout << "  并发上限 1 时最大并发: " << max_running.load() << " | 排队期间挂起的线程: " << parked << std::endl;
+    assert(starvation_ok && weight_ok && cap_ok);
+}
+
 // ==========================================
 // 主测试函数
 // ==========================================
@@ -322,6 +2019,28 @@ int main() {
         testInstantBurstTraffic();
         testIntenseResourceContention();
         testBoundaryAndRobustness();
+        testWorkStealing();
+        testFuturePromise();
+        testBulkSubmission();
+        testParallelLoops();
+        testPostFireAndForget();
+        testPriorityScheduling();
+        testBoundedQueue();
+        testLockFreeSubmitQueue();
+        testIdleParking();
+        testWorkerRetirement();
+        testFastStartup();
+        testEventSink();
+        testMetricsSnapshot();
+        testLatencyHistograms();
+        testTraceExport();
+        testAffinityAndNuma();
+        testTaskGraph();
+        testContinuations();
+        testTaskGroup();
+        testWorkerArena();
+        testTimerService();
+        testResourceGroups();
         
         auto global_end = std::chrono::high_resolution_clock::now();
         auto total_duration = std::chrono::duration_cast<std::chrono::seconds>(